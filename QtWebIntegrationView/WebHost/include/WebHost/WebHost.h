@@ -1,58 +1,272 @@
 #pragma once
 
+#include <QHash>
+#include <QJsonArray>
 #include <QJsonValue>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QSharedPointer>
 #include <QStringList>
+#include <QUrl>
 #include <QWidget>
 
+#include "HostApiEvent.h"
+
+class QIODevice;
+class QTimer;
 class QWebChannel;
 class QWebEnginePage;
 class QWebEngineProfile;
 class QWebEngineUrlRequestInterceptor;
 class QWebEngineView;
 
+class CborChannelTransport;
 class HostBridge;
+class WebAssetCache;
+class WebHostBlobRegistry;
+class WebHostSchemeHandler;
+class WebHostStreamRegistry;
+class WebHostUploadReceiver;
+class WebRootWatcher;
 
 class WebHost : public QWidget {
   Q_OBJECT
   Q_PROPERTY(QStringList validEventTypes READ validEventTypes CONSTANT)
 
 public:
+  // When the HostApi bootstrap is installed into the page. DocumentCreation registers it as a
+  // QWebEngineScript so the bridge comes up before the app bundle runs; LoadFinished injects it
+  // with runJavaScript once the page and all of its subresources have loaded.
+  enum class BootstrapMode { LoadFinished, DocumentCreation };
+
+  // How slotTriggerEvent reaches the page. Channel emits a HostBridge signal that the bootstrap
+  // subscribes to once; Script compiles and runs a dispatch script per event.
+  enum class EventDispatchMode { Script, Channel };
+
+  // How queued events of one type are coalesced while event batching is enabled. MergePayloads
+  // merges object payloads key by key and otherwise behaves like LatestOnly.
+  enum class EventBatchPolicy { DeliverAll, LatestOnly, MergePayloads };
+
+  // Wire format of QWebChannel messages. Json uses qt.webChannelTransport; Cbor encodes messages
+  // as CBOR and exchanges them over webhost://channel/, which avoids printing and re-parsing large
+  // payloads as JSON text. Cbor requires registerUrlScheme() before the application is created.
+  enum class ChannelTransport { Json, Cbor };
+
+  // Where setRootScheme() fills its in-memory asset cache from: the directory root or qrc:/web.
+  enum class AssetSource { Directory, Qrc };
+
+  // How long a published blob stays available. ReleaseAfterRead drops it once the page has
+  // fetched it; Persistent keeps it until releaseBlob(). Device blobs are always read once.
+  enum class BlobLifetime { ReleaseAfterRead, Persistent };
+
+  // Which QWebEngineProfile a new host loads its page in. PerInstance gives every host its own
+  // profile; Shared puts all hosts created in this mode on one reference-counted profile, so
+  // they share the HTTP cache, storage and network process state.
+  enum class ProfileMode { PerInstance, Shared };
+
+  // Counters for file:// requests seen by the web root interceptor in directory mode.
+  struct FileRequestStats {
+    quint64 requests = 0;
+    quint64 cacheHits = 0;
+    quint64 blocked = 0;
+    quint64 totalNanoseconds = 0;
+  };
+
   explicit WebHost(QWidget *parent = nullptr);
   explicit WebHost(const QString &webRoot, QWidget *parent = nullptr);
-  ~WebHost() override = default;
+  ~WebHost() override;
 
   static void registerUrlScheme();
 
+  // Applies to hosts constructed afterwards; an existing host keeps its profile.
+  static void setDefaultProfileMode(ProfileMode mode);
+  static ProfileMode defaultProfileMode();
+  ProfileMode profileMode() const;
+
   void setRootDir(const QString &webRoot);
   void setRootQrc();
+  // Serves the root from memory at webhost://app/<key>/. Responses carry a content-hash ETag the
+  // page can read to tell asset versions apart, and immutable Cache-Control for hashed bundles;
+  // custom scheme requests bypass Chromium's HTTP cache, so no conditional request reaches the
+  // host. A Directory source drops its copy of a file when the file changes on disk. Requires
+  // registerUrlScheme().
+  void setRootScheme(AssetSource source);
+  // Serves the root from a memory-mapped asset pack built by tools/WebAssetPacker, also over
+  // webhost://app/. A relative path is resolved against the application directory if it does
+  // not exist relative to the working directory. Returns false if the pack cannot be opened.
+  bool setRootPack(const QString &packPath);
+
+  // Applies to hosts constructed afterwards, so their first load already uses mode.
+  static void setDefaultBootstrapMode(BootstrapMode mode);
+  static BootstrapMode defaultBootstrapMode();
+  // Switches an existing host and reloads the page, since the bootstrap is installed per load.
+  void setBootstrapMode(BootstrapMode mode);
+  BootstrapMode bootstrapMode() const;
+
+  // Watches the directory root and, once changes settle for the debounce interval, sends the
+  // changed paths to the page. Stylesheets are swapped in place. Any other changed file the page
+  // has loaded goes to the handler registered with HostApi.setHotReloadHandler; unless it returns
+  // true the page reloads. Scripts are not replaced otherwise, and unloaded files are ignored.
+  void setHotReloadEnabled(bool enabled);
+  bool isHotReloadEnabled() const;
+  void setHotReloadDebounce(int intervalMs);
+  int hotReloadDebounce() const;
+
+  void setEventDispatchMode(EventDispatchMode mode);
+  EventDispatchMode eventDispatchMode() const;
+
+  // Switching the transport reloads the page.
+  void setChannelTransport(ChannelTransport transport);
+  ChannelTransport channelTransport() const;
+
+  // Queues slotTriggerEvent calls and delivers them as one array per flush. An interval of 0
+  // flushes once per display frame of the screen showing the host.
+  void setEventBatchingEnabled(bool enabled);
+  bool isEventBatchingEnabled() const;
+  void setEventBatchInterval(int intervalMs);
+  int eventBatchInterval() const;
+  void setEventBatchPolicy(const QString &eventType, EventBatchPolicy policy);
+  EventBatchPolicy eventBatchPolicy(const QString &eventType) const;
+
+  // Publishes binary data at webhost://blob/<id> for HostApi.fetchBlob(id) and returns the id.
+  // The QByteArray is shared with the reply rather than copied; the host takes ownership of a
+  // QIODevice and streams it to the page.
+  QString publishBlob(const QByteArray &data,
+                      const QString &mimeType = QStringLiteral("application/octet-stream"),
+                      BlobLifetime lifetime = BlobLifetime::ReleaseAfterRead);
+  QString publishBlob(QIODevice *device,
+                      const QString &mimeType = QStringLiteral("application/octet-stream"));
+  bool releaseBlob(const QString &id);
+  static QUrl blobUrl(const QString &id);
+
+  // Bodies sent with HostApi.upload(name, body) in JS are read in chunks and emitted through
+  // signalUploadChunk, or written to the sink registered for name. The sink must be open for
+  // writing and is not owned; nullptr removes it.
+  void setUploadSink(const QString &name, QIODevice *device);
+
+  // Host-to-page byte stream, read in JS as a ReadableStream from HostApi.openStream(id).
+  // writeStream returns false once highWaterMark bytes are waiting for the page; stop writing until
+  // signalStreamWritable. Streams end with closeStream, or are cancelled by the page or a reload.
+  QString openStream(qint64 highWaterMark = 1024 * 1024);
+  bool writeStream(const QString &id, const QByteArray &data);
+  void closeStream(const QString &id);
+  bool isStreamWritable(const QString &id) const;
+
+  FileRequestStats fileRequestStats() const;
+  void resetFileRequestStats();
 
   QStringList validEventTypes() const;
+  // slotTriggerEvent by generated id, so misspelled event names fail to compile. Not an overload
+  // of the slot, which keeps &WebHost::slotTriggerEvent unambiguous in connect().
+  void triggerEvent(HostApiEvent event, const QJsonValue &payload = QJsonValue::Null);
+  // True while the page has reported at least one HostApi listener for eventType. The page
+  // reports its count for a type whenever it adds or removes a listener for it; slotTriggerEvent
+  // drops events of a type reported at zero before they are serialized, and delivers types not
+  // reported on since the load started. The report crosses the channel asynchronously, so once a
+  // type has been reported at zero, an event triggered between the page's next addEventListener
+  // for it and the new count arriving is dropped.
+  bool hasEventSubscribers(const QString &eventType) const;
+  // True from signalHostApiReady until the next load starts. Until then slotTriggerEvent queues
+  // up to 256 events, dropping the oldest, and delivers them in one batch on readiness, except
+  // those of types the page has by then reported no listeners for.
+  bool isHostApiReady() const;
 
 signals:
   void signalSendData(QJsonValue value);
   void signalSetOutput(QString output);
   void signalGetInput(QString uuid);
+  void signalLoadFinished(bool ok);
+  // Emitted once the page's HostApi is built and its HostApiReady listeners have run.
+  void signalHostApiReady(QString version);
+  void signalBlobReleased(QString id);
+  void signalUploadStarted(QString uploadId, QString name);
+  void signalUploadChunk(QString uploadId, QByteArray chunk);
+  void signalUploadFinished(QString uploadId, QString name, qint64 size, bool ok);
+  void signalStreamWritable(QString id);
+  void signalStreamCancelled(QString id);
+  void signalHotReload(QStringList paths);
 
 public slots:
   void slotProvideInput(QString uuid, QString input);
+  // Event types not listed by hostApiEventTypes() are rejected with a warning; triggerEvent
+  // catches misspelled names at compile time.
   void slotTriggerEvent(QString actionId, QJsonValue payload = QJsonValue::Null);
+  void slotFlushEvents();
 
 private:
-  enum class RootMode { Directory, Qrc };
+  friend class WebHostGroup;
+
+  enum class RootMode { Directory, Qrc, Scheme, Pack };
+
+  // An event delivered to several hosts. Channel and batching hosts take the payload as is; the
+  // Script dispatch source is built by the first Script host and reused by the others.
+  struct PreparedEvent {
+    QString eventType;
+    int eventId = -1;
+    QJsonValue payload;
+    QString script;
+  };
+
+  static QString eventScript(int eventId, const QJsonValue &payload);
+  void deliverPreparedEvent(PreparedEvent *event);
+  // Whether an event of eventType is delivered: see hasEventSubscribers.
+  bool wantsEvent(const QString &eventType) const;
 
   void initialize(const QString &webRoot);
   void applyWindowBackground();
   void injectHostApiBootstrap();
+  void installHostApiBootstrap();
+  QString hostApiBootstrapScript() const;
   void loadRoot();
+  void connectChannelTransport();
+  void dispatchEvent(const QString &eventType, const QJsonValue &payload);
+  void dispatchEventBatch(const QJsonArray &events);
+  void enqueueEvent(const QString &eventType, const QJsonValue &payload);
+  void queuePreReadyEvent(const QString &eventType, const QJsonValue &payload);
+  void flushPreReadyEvents();
+  int eventBatchTimerInterval() const;
+  bool servesRootFromDisk() const;
+  void updateRootWatcher();
+  void watchHotReloadRoot();
+  bool watchesLoadedFiles() const;
+  void noteLoadedFile(const QString &path);
+  void flushHotReload();
 
   QWebEngineView *m_view = nullptr;
-  QWebEngineProfile *m_profile = nullptr;
+  QSharedPointer<QWebEngineProfile> m_profile;
+  ProfileMode m_profileMode = ProfileMode::PerInstance;
   QWebEnginePage *m_page = nullptr;
   QWebEngineUrlRequestInterceptor *m_interceptor = nullptr;
   QWebChannel *m_channel = nullptr;
   HostBridge *m_bridge = nullptr;
+  WebHostSchemeHandler *m_schemeHandler = nullptr;
+  CborChannelTransport *m_cborTransport = nullptr;
+  WebHostBlobRegistry *m_blobRegistry = nullptr;
+  WebHostUploadReceiver *m_uploadReceiver = nullptr;
+  WebHostStreamRegistry *m_streamRegistry = nullptr;
+  QSharedPointer<WebAssetCache> m_assetCache;
   QString m_webRoot;
   QString m_qrcRoot;
   RootMode m_rootMode = RootMode::Directory;
+  AssetSource m_schemeSource = AssetSource::Directory;
+  BootstrapMode m_bootstrapMode = BootstrapMode::DocumentCreation;
+  EventDispatchMode m_eventDispatchMode = EventDispatchMode::Channel;
+  ChannelTransport m_channelTransport = ChannelTransport::Json;
   QStringList m_validEventTypes;
+  QTimer *m_eventBatchTimer = nullptr;
+  bool m_eventBatchingEnabled = false;
+  int m_eventBatchIntervalMs = 0;
+  QHash<QString, EventBatchPolicy> m_eventBatchPolicies;
+  QList<QPair<QString, QJsonValue>> m_pendingEvents;
+  QHash<QString, int> m_pendingEventIndex;
+  bool m_hostApiReady = false;
+  QList<QPair<QString, QJsonValue>> m_preReadyEvents;
+  int m_preReadyDropped = 0;
+  WebRootWatcher *m_rootWatcher = nullptr;
+  QTimer *m_hotReloadTimer = nullptr;
+  bool m_hotReloadEnabled = false;
+  QSet<QString> m_hotReloadPaths;
+  // file:// paths the interceptor has allowed; the files hot reload watches individually.
+  QSet<QString> m_loadedFiles;
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QJsonValue>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+
+#include "HostApiEvent.h"
+
+class WebHost;
+
+// Fans HostApi events out to several WebHosts: one call applies each member's event filter, the
+// hidden-member policy and the subscriber check. It is not a serialize-once broadcast. QWebChannel
+// encodes every message per transport, so members in Channel dispatch, the default, each encode
+// the payload as their own slotTriggerEvent would; only Script members share one dispatch script.
+class WebHostGroup : public QObject {
+  Q_OBJECT
+
+public:
+  // What happens to an event for a member that is not visible. Skip drops it; Defer keeps the
+  // latest payload per event type and delivers those, in arrival order, when the member is shown.
+  enum class HiddenPolicy { Deliver, Skip, Defer };
+
+  explicit WebHostGroup(QObject *parent = nullptr);
+
+  // eventTypes limits which events the member receives; an empty list accepts all of them. The
+  // group does not own its members; a destroyed host leaves the group.
+  void addHost(WebHost *host, const QStringList &eventTypes = {});
+  void removeHost(WebHost *host);
+  bool contains(WebHost *host) const;
+  QList<WebHost *> hosts() const;
+  void setEventFilter(WebHost *host, const QStringList &eventTypes);
+
+  void setHiddenPolicy(HiddenPolicy policy);
+  HiddenPolicy hiddenPolicy() const;
+  int deferredEventCount(WebHost *host) const;
+
+  // slotTriggerEvent by generated id; a separate name keeps the slot unambiguous in connect().
+  void triggerEvent(HostApiEvent event, const QJsonValue &payload = QJsonValue::Null);
+
+public slots:
+  void slotTriggerEvent(QString eventType, QJsonValue payload = QJsonValue::Null);
+
+protected:
+  bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+  struct Member {
+    QPointer<WebHost> host;
+    QSet<QString> eventTypes;
+    QList<QPair<QString, QJsonValue>> deferred;
+  };
+
+  Member *findMember(const QObject *host);
+  const Member *findMember(const QObject *host) const;
+  void flushDeferred(Member *member);
+
+  QList<Member> m_members;
+  HiddenPolicy m_hiddenPolicy = HiddenPolicy::Deliver;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+
+#include <functional>
+
+class QTimer;
+class QWidget;
+class WebHost;
+
+// Keeps a number of hidden WebHosts with their HostApi up so a new panel can show one immediately.
+// acquire() hands out a warm host and the pool refills in the background, one host per event loop
+// pass. After idleTimeout without an acquire the warm hosts are released until the next acquire.
+// A host whose load fails or that is not ready within warmupTimeout is deleted, and refills back
+// off exponentially until a host becomes ready again.
+class WebHostPool : public QObject {
+  Q_OBJECT
+
+public:
+  using Factory = std::function<WebHost *()>;
+
+  explicit WebHostPool(QObject *parent = nullptr);
+  explicit WebHostPool(Factory factory, QObject *parent = nullptr);
+  ~WebHostPool() override;
+
+  void setSize(int size);
+  int size() const;
+  // 0 disables idle eviction.
+  void setIdleTimeout(int timeoutMs);
+  int idleTimeout() const;
+  // 0 disables the timeout; a failed load still discards the host.
+  void setWarmupTimeout(int timeoutMs);
+  int warmupTimeout() const;
+
+  int readyCount() const;
+  int warmingCount() const;
+
+  // Returns a warm host when one is ready and a freshly created one otherwise. The caller owns the
+  // returned host; it is reparented to parent and left hidden.
+  WebHost *acquire(QWidget *parent = nullptr);
+
+signals:
+  void signalHostReady();
+  void signalHostFailed();
+
+public slots:
+  void slotRefill();
+
+private:
+  void scheduleRefill();
+  void hostReady(WebHost *host);
+  void hostFailed(WebHost *host, const char *reason);
+  void evictIdle();
+
+  Factory m_factory;
+  int m_size = 1;
+  int m_idleTimeoutMs = 0;
+  int m_warmupTimeoutMs = 15000;
+  int m_failures = 0;
+  bool m_evicted = false;
+  bool m_refillScheduled = false;
+  QList<QPointer<WebHost>> m_warming;
+  QList<QPointer<WebHost>> m_ready;
+  QElapsedTimer m_sinceAcquire;
+  QTimer *m_idleTimer = nullptr;
+};
@@ -0,0 +1,187 @@
+#include "CborChannelTransport.h"
+
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborStreamWriter>
+#include <QCborValue>
+#include <QDebug>
+#include <QIODevice>
+#include <QJsonArray>
+#include <QUuid>
+#include <QWebEngineUrlRequestJob>
+#include <QtEndian>
+
+#include <cmath>
+
+#include "WebHostSchemeHandler.h"
+
+namespace {
+
+const QByteArray kCborContentType = QByteArrayLiteral("application/cbor");
+constexpr qsizetype kMaxOutboxBytes = 64 * 1024 * 1024;
+
+// Encodes a CBOR array header, used to frame items that are already encoded.
+QByteArray cborArrayHead(quint64 count) {
+  constexpr char kArray = 4 << 5;
+  char buffer[9];
+  if (count < 24) {
+    buffer[0] = static_cast<char>(kArray | count);
+    return QByteArray(buffer, 1);
+  }
+  if (count <= 0xffff) {
+    buffer[0] = static_cast<char>(kArray | 25);
+    qToBigEndian<quint16>(static_cast<quint16>(count), buffer + 1);
+    return QByteArray(buffer, 3);
+  }
+  if (count <= 0xffffffffULL) {
+    buffer[0] = static_cast<char>(kArray | 26);
+    qToBigEndian<quint32>(static_cast<quint32>(count), buffer + 1);
+    return QByteArray(buffer, 5);
+  }
+  buffer[0] = static_cast<char>(kArray | 27);
+  qToBigEndian<quint64>(count, buffer + 1);
+  return QByteArray(buffer, 9);
+}
+
+// Writes a JSON value straight to CBOR. Whole numbers within the exact range of a double become
+// CBOR integers, matching QCborValue::fromJsonValue.
+void writeJson(QCborStreamWriter &writer, const QJsonValue &value) {
+  switch (value.type()) {
+  case QJsonValue::Null:
+    writer.append(nullptr);
+    break;
+  case QJsonValue::Bool:
+    writer.append(value.toBool());
+    break;
+  case QJsonValue::Double: {
+    const double number = value.toDouble();
+    if (std::trunc(number) == number && std::abs(number) <= 9007199254740992.0) {
+      writer.append(static_cast<qint64>(number));
+    } else {
+      writer.append(number);
+    }
+    break;
+  }
+  case QJsonValue::String:
+    writer.append(value.toString());
+    break;
+  case QJsonValue::Array: {
+    const QJsonArray array = value.toArray();
+    writer.startArray(static_cast<quint64>(array.size()));
+    for (const QJsonValue &item : array) {
+      writeJson(writer, item);
+    }
+    writer.endArray();
+    break;
+  }
+  case QJsonValue::Object: {
+    const QJsonObject object = value.toObject();
+    writer.startMap(static_cast<quint64>(object.size()));
+    for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+      writer.append(it.key());
+      writeJson(writer, it.value());
+    }
+    writer.endMap();
+    break;
+  }
+  case QJsonValue::Undefined:
+    writer.append(QCborSimpleType::Undefined);
+    break;
+  }
+}
+
+} // namespace
+
+CborChannelTransport::CborChannelTransport(QObject *parent)
+    : QWebChannelAbstractTransport(parent),
+      m_token(QUuid::createUuid().toString(QUuid::Id128)) {}
+
+QString CborChannelTransport::token() const {
+  return m_token;
+}
+
+QString CborChannelTransport::baseUrl() const {
+  return QStringLiteral("webhost://channel/") + m_token;
+}
+
+void CborChannelTransport::sendMessage(const QJsonObject &message) {
+  const qsizetype queued = m_outbox.size();
+  {
+    QCborStreamWriter writer(&m_outbox);
+    writeJson(writer, message);
+  }
+  if (m_outbox.size() > kMaxOutboxBytes) {
+    qWarning() << "WebHost CBOR channel dropped a" << (m_outbox.size() - queued)
+               << "byte message: the page is not polling and" << queued << "bytes are queued.";
+    m_outbox.truncate(queued);
+    return;
+  }
+  ++m_outboxCount;
+  flush();
+}
+
+bool CborChannelTransport::handleRequest(QWebEngineUrlRequestJob *job, const QString &path) {
+  const int separator = path.indexOf(QLatin1Char('/'));
+  if (separator < 0 || path.left(separator) != m_token) {
+    return false;
+  }
+
+  WebHostSchemeHandler::allowCrossOrigin(job);
+  const QString action = path.mid(separator + 1);
+  if (action == QLatin1String("recv")) {
+    if (m_pendingPoll) {
+      // Only one poll is expected at a time; release the stale one empty.
+      WebHostSchemeHandler::replyWithData(m_pendingPoll, kCborContentType, cborArrayHead(0));
+    }
+    m_pendingPoll = job;
+    flush();
+    return true;
+  }
+  if (action == QLatin1String("send") && job->requestMethod() == "POST") {
+    receive(job);
+    return true;
+  }
+
+  job->fail(QWebEngineUrlRequestJob::RequestDenied);
+  return true;
+}
+
+void CborChannelTransport::reset() {
+  m_outbox.clear();
+  m_outboxCount = 0;
+}
+
+void CborChannelTransport::flush() {
+  if (!m_pendingPoll || m_outbox.isEmpty()) {
+    return;
+  }
+
+  QByteArray body = cborArrayHead(m_outboxCount);
+  body.append(m_outbox);
+  m_outbox.clear();
+  m_outboxCount = 0;
+
+  QWebEngineUrlRequestJob *job = m_pendingPoll;
+  m_pendingPoll.clear();
+  WebHostSchemeHandler::replyWithData(job, kCborContentType, body);
+}
+
+void CborChannelTransport::receive(QWebEngineUrlRequestJob *job) {
+  QIODevice *body = job->requestBody();
+  const QByteArray data = body ? body->readAll() : QByteArray();
+  WebHostSchemeHandler::replyWithData(job, kCborContentType, QByteArray());
+
+  QCborParserError error;
+  const QCborValue value = QCborValue::fromCbor(data, &error);
+  if (error.error != QCborError::NoError || !value.isArray()) {
+    qWarning() << "WebHost CBOR channel received an invalid message batch:" << error.errorString();
+    return;
+  }
+
+  const QCborArray messages = value.toArray();
+  for (const QCborValue &message : messages) {
+    if (message.isMap()) {
+      emit messageReceived(message.toMap().toJsonObject(), this);
+    }
+  }
+}
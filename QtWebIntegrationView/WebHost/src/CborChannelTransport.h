@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QPointer>
+#include <QString>
+#include <QWebChannelAbstractTransport>
+
+class QWebEngineUrlRequestJob;
+
+// QWebChannel transport that carries channel messages as CBOR over the webhost:// scheme instead
+// of JSON text over qt.webChannelTransport. The page long-polls
+// webhost://channel/<token>/recv for host messages and POSTs its own to .../send; both bodies are
+// CBOR arrays of messages. Messages waiting for a poll are capped at 64 MiB; a message that would
+// exceed the cap is dropped with a warning.
+class CborChannelTransport : public QWebChannelAbstractTransport {
+  Q_OBJECT
+
+public:
+  explicit CborChannelTransport(QObject *parent = nullptr);
+
+  QString token() const;
+  QString baseUrl() const;
+
+  void sendMessage(const QJsonObject &message) override;
+
+  // Route handler for webhost://channel/...; returns false for other tokens.
+  bool handleRequest(QWebEngineUrlRequestJob *job, const QString &path);
+
+  // Drops queued messages, e.g. when the page navigates away.
+  void reset();
+
+private:
+  void flush();
+  void receive(QWebEngineUrlRequestJob *job);
+
+  QString m_token;
+  // Encoded messages waiting for the next poll, back to back.
+  QByteArray m_outbox;
+  quint64 m_outboxCount = 0;
+  QPointer<QWebEngineUrlRequestJob> m_pendingPoll;
+};
@@ -0,0 +1,251 @@
+#include "WebAssetCache.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QMultiMap>
+#include <QRegularExpression>
+#include <QResource>
+#include <QWebEngineUrlRequestJob>
+
+#include <iterator>
+
+#include "WebAssetPack.h"
+#include "WebHostSchemeHandler.h"
+
+namespace {
+
+// Angular's output hashing names bundles like main.3f2a1b9c8d7e6f5a.js; such files never change
+// under the same name and can be cached forever.
+bool isHashedAsset(const QString &path) {
+  static const QRegularExpression pattern(QStringLiteral("[.-][0-9a-fA-F]{16,}\\.[A-Za-z0-9]+$"));
+  return pattern.match(path).hasMatch();
+}
+
+QByteArray mimeTypeForPath(const QString &path) {
+  // QMimeDatabase has no entry for source maps and reports .mjs inconsistently.
+  if (path.endsWith(QLatin1String(".js")) || path.endsWith(QLatin1String(".mjs"))) {
+    return QByteArrayLiteral("text/javascript");
+  }
+  if (path.endsWith(QLatin1String(".map")) || path.endsWith(QLatin1String(".json"))) {
+    return QByteArrayLiteral("application/json");
+  }
+  static const QMimeDatabase database;
+  return database.mimeTypeForFile(path, QMimeDatabase::MatchExtension).name().toUtf8();
+}
+
+QByteArray readAsset(const QString &filePath) {
+  // Entries stored uncompressed in the qrc are referenced in place instead of copied.
+  if (filePath.startsWith(QLatin1Char(':'))) {
+    const QResource resource(filePath);
+    if (resource.isValid() && !resource.isDir() &&
+        resource.compressionAlgorithm() == QResource::NoCompression) {
+      return QByteArray::fromRawData(reinterpret_cast<const char *>(resource.data()),
+                                     resource.size());
+    }
+  }
+
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QByteArray();
+  }
+  return file.readAll();
+}
+
+// Reply body for a pack entry. Its data points into the pack's mapping, so the buffer holds the
+// pack until the job that owns it is deleted.
+class PackReplyBuffer : public QBuffer {
+public:
+  PackReplyBuffer(const QSharedPointer<WebAssetPack> &pack, const QByteArray &data,
+                  QObject *parent)
+      : QBuffer(parent), m_pack(pack) {
+    setData(data);
+    open(QIODevice::ReadOnly);
+  }
+
+private:
+  QSharedPointer<WebAssetPack> m_pack;
+};
+
+QHash<QString, QWeakPointer<WebAssetCache>> &sharedCaches() {
+  static QHash<QString, QWeakPointer<WebAssetCache>> caches;
+  return caches;
+}
+
+// Drops entries whose cache has been released, so the registry does not grow with every root or
+// pack a process has ever shown.
+void pruneSharedCaches() {
+  QHash<QString, QWeakPointer<WebAssetCache>> &caches = sharedCaches();
+  for (auto it = caches.begin(); it != caches.end();) {
+    it = it.value().isNull() ? caches.erase(it) : std::next(it);
+  }
+}
+
+// True if the cleaned relative path climbs out of its root.
+bool escapesRoot(const QString &relative) {
+  return relative == QLatin1String("..") || relative.startsWith(QLatin1String("../"));
+}
+
+} // namespace
+
+QSharedPointer<WebAssetCache> WebAssetCache::forRoot(const QString &rootPath) {
+  pruneSharedCaches();
+  const QString normalized = QDir::cleanPath(rootPath);
+  QSharedPointer<WebAssetCache> cache = sharedCaches().value(normalized).toStrongRef();
+  if (!cache) {
+    cache = QSharedPointer<WebAssetCache>(new WebAssetCache(normalized));
+    sharedCaches().insert(normalized, cache);
+  }
+  return cache;
+}
+
+QSharedPointer<WebAssetCache> WebAssetCache::forPack(const QString &packPath,
+                                                     QString *errorString) {
+  const QString normalized = QFileInfo(packPath).absoluteFilePath();
+  const QString cacheKey = QStringLiteral("pack:") + normalized;
+  pruneSharedCaches();
+  QSharedPointer<WebAssetCache> cache = sharedCaches().value(cacheKey).toStrongRef();
+  if (cache) {
+    return cache;
+  }
+
+  QSharedPointer<WebAssetPack> pack = WebAssetPack::open(normalized, errorString);
+  if (!pack) {
+    return {};
+  }
+  cache = QSharedPointer<WebAssetCache>(new WebAssetCache(cacheKey));
+  cache->m_pack = pack;
+  sharedCaches().insert(cacheKey, cache);
+  return cache;
+}
+
+WebAssetCache::WebAssetCache(const QString &rootPath)
+    : m_rootPath(rootPath),
+      m_key(QString::fromLatin1(QCryptographicHash::hash(rootPath.toUtf8(),
+                                                         QCryptographicHash::Sha1)
+                                    .toHex()
+                                    .left(12))) {}
+
+QString WebAssetCache::rootPath() const {
+  return m_rootPath;
+}
+
+QString WebAssetCache::key() const {
+  return m_key;
+}
+
+QString WebAssetCache::baseUrl() const {
+  return QStringLiteral("webhost://app/") + m_key + QLatin1Char('/');
+}
+
+bool WebAssetCache::lookup(const QString &path, Asset *asset) {
+  const auto cached = m_assets.constFind(path);
+  if (cached != m_assets.cend()) {
+    *asset = cached.value();
+    return true;
+  }
+  if (m_missing.contains(path)) {
+    return false;
+  }
+
+  if (m_pack) {
+    Asset packed;
+    QByteArray sha256;
+    if (!m_pack->find(QDir::cleanPath(path), &packed.data, &sha256)) {
+      m_missing.insert(path);
+      return false;
+    }
+    packed.mimeType = mimeTypeForPath(path);
+    packed.etag = '"' +
+                  sha256.toBase64(QByteArray::Base64UrlEncoding |
+                                  QByteArray::OmitTrailingEquals) +
+                  '"';
+    packed.immutable = isHashedAsset(path);
+    m_assets.insert(path, packed);
+    *asset = packed;
+    return true;
+  }
+
+  const QString relative = QDir::cleanPath(path);
+  const QString filePath = m_rootPath + QLatin1Char('/') + relative;
+  if (relative.isEmpty() || escapesRoot(relative) ||
+      QDir::isAbsolutePath(relative) || !QFileInfo(filePath).isFile()) {
+    m_missing.insert(path);
+    return false;
+  }
+
+  Asset loaded;
+  loaded.data = readAsset(filePath);
+  loaded.mimeType = mimeTypeForPath(relative);
+  loaded.etag = '"' +
+                QCryptographicHash::hash(loaded.data, QCryptographicHash::Sha256)
+                    .toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals) +
+                '"';
+  loaded.immutable = isHashedAsset(relative);
+  m_assets.insert(path, loaded);
+  *asset = loaded;
+  return true;
+}
+
+void WebAssetCache::clear() {
+  m_assets.clear();
+  m_missing.clear();
+}
+
+void WebAssetCache::evict(const QStringList &filePaths) {
+  if (m_pack || filePaths.isEmpty()) {
+    return;
+  }
+  const QDir root(m_rootPath);
+  QSet<QString> changed;
+  for (const QString &filePath : filePaths) {
+    changed.insert(QDir::cleanPath(root.relativeFilePath(filePath)));
+  }
+  // Keys are request paths, which may not be clean.
+  m_assets.removeIf([&changed](QHash<QString, Asset>::iterator it) {
+    return changed.contains(QDir::cleanPath(it.key()));
+  });
+  m_missing.removeIf(
+      [&changed](const QString &path) { return changed.contains(QDir::cleanPath(path)); });
+}
+
+bool WebAssetCache::handleRequest(QWebEngineUrlRequestJob *job, const QString &path,
+                                  QString *filePath) {
+  const int separator = path.indexOf(QLatin1Char('/'));
+  if (separator < 0 || path.left(separator) != m_key) {
+    return false;
+  }
+
+  const QString assetPath = path.mid(separator + 1);
+  Asset asset;
+  if (!lookup(assetPath, &asset)) {
+    qWarning() << "WebHost asset not found:" << job->requestUrl();
+    job->fail(QWebEngineUrlRequestJob::UrlNotFound);
+    return true;
+  }
+
+  // Module scripts are fetched in CORS mode and webhost:// pages have an opaque origin, so every
+  // asset is served cross-origin readable.
+  QMultiMap<QByteArray, QByteArray> headers;
+  headers.insert(QByteArrayLiteral("Access-Control-Allow-Origin"), QByteArrayLiteral("*"));
+  headers.insert(QByteArrayLiteral("Access-Control-Expose-Headers"), QByteArrayLiteral("ETag"));
+  headers.insert(QByteArrayLiteral("ETag"), asset.etag);
+  headers.insert(QByteArrayLiteral("Cache-Control"),
+                 asset.immutable ? QByteArrayLiteral("public, max-age=31536000, immutable")
+                                 : QByteArrayLiteral("no-cache"));
+  job->setAdditionalResponseHeaders(headers);
+
+  if (m_pack) {
+    job->reply(asset.mimeType, new PackReplyBuffer(m_pack, asset.data, job));
+  } else {
+    WebHostSchemeHandler::replyWithData(job, asset.mimeType, asset.data);
+  }
+  if (filePath && !m_pack && !m_rootPath.startsWith(QLatin1Char(':'))) {
+    *filePath = m_rootPath + QLatin1Char('/') + QDir::cleanPath(assetPath);
+  }
+  return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+class QWebEngineUrlRequestJob;
+class WebAssetPack;
+
+// In-memory copy of a web root (a directory or a Qt resource prefix) served at
+// webhost://app/<key>/<path>. Assets are read once, on first request, and stay resident together
+// with their MIME type and a content-hash ETag. Hosts showing the same root share one cache.
+// A cache can also front a WebAssetPack, whose entries are served from the mapping.
+class WebAssetCache {
+public:
+  struct Asset {
+    QByteArray data;
+    QByteArray mimeType;
+    QByteArray etag;
+    bool immutable = false;
+  };
+
+  static QSharedPointer<WebAssetCache> forRoot(const QString &rootPath);
+  static QSharedPointer<WebAssetCache> forPack(const QString &packPath,
+                                               QString *errorString = nullptr);
+
+  QString rootPath() const;
+  QString key() const;
+  QString baseUrl() const;
+
+  bool lookup(const QString &path, Asset *asset);
+  void clear();
+  // Forgets what is cached, found or missing, for these absolute file paths under a directory
+  // root, so the next request reads them from disk again.
+  void evict(const QStringList &filePaths);
+
+  // Route handler for webhost://app/<key>/<path>; returns false for other keys. For a directory
+  // root, filePath receives the file an asset was served from.
+  bool handleRequest(QWebEngineUrlRequestJob *job, const QString &path,
+                     QString *filePath = nullptr);
+
+private:
+  explicit WebAssetCache(const QString &rootPath);
+
+  QSharedPointer<WebAssetPack> m_pack;
+  QString m_rootPath;
+  QString m_key;
+  QHash<QString, Asset> m_assets;
+  QSet<QString> m_missing;
+};
@@ -0,0 +1,100 @@
+#include "WebAssetPack.h"
+
+#include <QByteArrayView>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+QByteArrayView entryPath(const char *strings, const WebAssetPackFormat::Entry &entry) {
+  return QByteArrayView(strings + entry.pathOffset, entry.pathLength);
+}
+
+} // namespace
+
+QSharedPointer<WebAssetPack> WebAssetPack::open(const QString &path, QString *errorString) {
+  using namespace WebAssetPackFormat;
+
+  auto fail = [errorString](const QString &message) {
+    if (errorString) {
+      *errorString = message;
+    }
+    return QSharedPointer<WebAssetPack>();
+  };
+
+  QSharedPointer<WebAssetPack> pack(new WebAssetPack);
+  pack->m_file.setFileName(path);
+  if (!pack->m_file.open(QIODevice::ReadOnly)) {
+    return fail(pack->m_file.errorString());
+  }
+  pack->m_size = pack->m_file.size();
+  if (pack->m_size < qint64(sizeof(Header))) {
+    return fail(QStringLiteral("file is too small"));
+  }
+  pack->m_data = pack->m_file.map(0, pack->m_size);
+  if (!pack->m_data) {
+    return fail(pack->m_file.errorString());
+  }
+
+  const auto *header = reinterpret_cast<const Header *>(pack->m_data);
+  if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion) {
+    return fail(QStringLiteral("not a version %1 web asset pack").arg(kVersion));
+  }
+
+  const quint64 size = quint64(pack->m_size);
+  const quint64 indexEnd = header->indexOffset + quint64(header->entryCount) * sizeof(Entry);
+  if (header->indexOffset % alignof(Entry) != 0 || indexEnd > size ||
+      header->stringsOffset > size) {
+    return fail(QStringLiteral("index is out of bounds"));
+  }
+
+  pack->m_entries = reinterpret_cast<const Entry *>(pack->m_data + header->indexOffset);
+  pack->m_entryCount = header->entryCount;
+  pack->m_strings = reinterpret_cast<const char *>(pack->m_data + header->stringsOffset);
+
+  // Validate once so lookups can trust offsets and ordering.
+  const quint64 stringsSize = size - header->stringsOffset;
+  for (quint32 i = 0; i < pack->m_entryCount; ++i) {
+    const Entry &entry = pack->m_entries[i];
+    if (quint64(entry.pathOffset) + entry.pathLength > stringsSize ||
+        entry.dataOffset > size || entry.dataSize > size - entry.dataOffset) {
+      return fail(QStringLiteral("entry %1 is out of bounds").arg(i));
+    }
+    if (i > 0 && !(entryPath(pack->m_strings, pack->m_entries[i - 1]) <
+                   entryPath(pack->m_strings, entry))) {
+      return fail(QStringLiteral("index is not sorted"));
+    }
+  }
+  return pack;
+}
+
+QString WebAssetPack::path() const {
+  return m_file.fileName();
+}
+
+int WebAssetPack::entryCount() const {
+  return int(m_entryCount);
+}
+
+bool WebAssetPack::find(const QString &assetPath, QByteArray *data, QByteArray *sha256) const {
+  const QByteArray key = assetPath.toUtf8();
+  const auto *end = m_entries + m_entryCount;
+  const auto *it = std::lower_bound(m_entries, end, QByteArrayView(key),
+                                    [this](const WebAssetPackFormat::Entry &entry,
+                                           QByteArrayView path) {
+                                      return entryPath(m_strings, entry) < path;
+                                    });
+  if (it == end || entryPath(m_strings, *it) != QByteArrayView(key)) {
+    return false;
+  }
+
+  if (data) {
+    *data = QByteArray::fromRawData(reinterpret_cast<const char *>(m_data + it->dataOffset),
+                                    qsizetype(it->dataSize));
+  }
+  if (sha256) {
+    *sha256 = QByteArray(reinterpret_cast<const char *>(it->sha256), sizeof(it->sha256));
+  }
+  return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+
+#include "WebAssetPackFormat.h"
+
+// Read-only view of a web asset pack. The file is memory-mapped once; lookups are a binary search
+// over the mapped index and return the entry data in place, so serving an asset costs no file
+// system calls and no copies.
+class WebAssetPack {
+public:
+  static QSharedPointer<WebAssetPack> open(const QString &path, QString *errorString = nullptr);
+
+  QString path() const;
+  int entryCount() const;
+
+  // data references the mapping and stays valid while the pack is alive.
+  bool find(const QString &assetPath, QByteArray *data, QByteArray *sha256) const;
+
+private:
+  WebAssetPack() = default;
+
+  QFile m_file;
+  const uchar *m_data = nullptr;
+  qint64 m_size = 0;
+  const WebAssetPackFormat::Entry *m_entries = nullptr;
+  quint32 m_entryCount = 0;
+  const char *m_strings = nullptr;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QtEndian>
+
+// On-disk layout of a web asset pack, written by tools/WebAssetPacker and read by WebAssetPack:
+//
+//   Header
+//   Entry[entryCount], sorted by the bytes of their UTF-8 paths
+//   path strings, UTF-8 without terminators
+//   entry data, each entry starting on a kAlignment boundary
+//
+// All integers are little-endian.
+namespace WebAssetPackFormat {
+
+constexpr char kMagic[8] = {'W', 'H', 'P', 'A', 'C', 'K', '\0', '\0'};
+constexpr quint32 kVersion = 1;
+constexpr quint64 kAlignment = 4096;
+
+struct Header {
+  char magic[8];
+  quint32_le version;
+  quint32_le entryCount;
+  quint64_le indexOffset;
+  quint64_le stringsOffset;
+};
+
+struct Entry {
+  quint32_le pathOffset; // Relative to Header::stringsOffset.
+  quint32_le pathLength;
+  quint64_le dataOffset;
+  quint64_le dataSize;
+  quint8 sha256[32];
+  quint64_le reserved;
+};
+
+static_assert(sizeof(Header) == 32, "unexpected pack header size");
+static_assert(sizeof(Entry) == 64, "unexpected pack entry size");
+
+} // namespace WebAssetPackFormat
@@ -4,26 +4,44 @@
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QMetaType>
+#include <QPointer>
+#include <QReadWriteLock>
 #include <QResource>
+#include <QScreen>
 #include <QStandardPaths>
+#include <QTimer>
 #include <QVBoxLayout>
 #include <QWebChannel>
 #include <QWebEnginePage>
 #include <QWebEngineProfile>
+#include <QWebEngineScript>
+#include <QWebEngineScriptCollection>
 #include <QWebEngineSettings>
 #include <QWebEngineUrlRequestInterceptor>
 #include <QWebEngineUrlScheme>
 #include <QWebEngineView>
 #include <QUuid>
 
+#include <functional>
+#include <utility>
+
+#include "CborChannelTransport.h"
 #include "HostApiEventTypes.h"
 #include "HostApiGenerated.h"
 #include "HostApiVersion.h"
+#include "WebAssetCache.h"
+#include "WebHostBlobRegistry.h"
+#include "WebHostSchemeHandler.h"
+#include "WebHostStreamRegistry.h"
+#include "WebHostUploadReceiver.h"
+#include "WebRootWatcher.h"
 
 static void ensureWebResourcesRegistered() {
   static bool registered = false;
@@ -36,15 +54,55 @@ static void ensureWebResourcesRegistered() {
 
 namespace {
 
+// Blocks file:// requests outside the web root. Allow/deny decisions are cached per URL path
+// because interceptRequest runs for every subresource; the host's WebRootWatcher calls invalidate
+// whenever the tree changes. A decision computed across a setRootDir or invalidate is not cached.
 class WebRootInterceptor : public QWebEngineUrlRequestInterceptor {
 public:
   explicit WebRootInterceptor(const QString &rootDir, QObject *parent = nullptr)
       : QWebEngineUrlRequestInterceptor(parent) {
-    setRoot(rootDir);
+    setRootDir(rootDir);
   }
 
   void setRootDir(const QString &rootDir) {
-    setRoot(rootDir);
+    QString absolute = QDir(rootDir).absolutePath();
+    if (!absolute.endsWith(QDir::separator())) {
+      absolute += QDir::separator();
+    }
+    QWriteLocker locker(&m_lock);
+    m_rootAbsolute = absolute;
+    m_decisions.clear();
+    ++m_generation;
+  }
+
+  // fileAllowed runs on context's thread for each file:// path the page is allowed to load, once
+  // per decision.
+  void setFileAllowedHandler(QObject *context, std::function<void(const QString &)> fileAllowed) {
+    m_context = context;
+    m_fileAllowed = std::move(fileAllowed);
+  }
+
+  // Called when the root's directory tree changes: a path may now resolve differently.
+  void invalidate() {
+    QWriteLocker locker(&m_lock);
+    m_decisions.clear();
+    ++m_generation;
+  }
+
+  WebHost::FileRequestStats stats() const {
+    WebHost::FileRequestStats stats;
+    stats.requests = m_requests.loadRelaxed();
+    stats.cacheHits = m_cacheHits.loadRelaxed();
+    stats.blocked = m_blocked.loadRelaxed();
+    stats.totalNanoseconds = m_totalNanoseconds.loadRelaxed();
+    return stats;
+  }
+
+  void resetStats() {
+    m_requests.storeRelaxed(0);
+    m_cacheHits.storeRelaxed(0);
+    m_blocked.storeRelaxed(0);
+    m_totalNanoseconds.storeRelaxed(0);
   }
 
   void interceptRequest(QWebEngineUrlRequestInfo &info) override {
@@ -53,31 +111,76 @@ public:
       return;
     }
 
-    const QString localPath = QDir::cleanPath(url.toLocalFile());
-    QFileInfo fileInfo(localPath);
-    const QString absolutePath = fileInfo.absoluteFilePath();
-    const QString canonicalPath = fileInfo.exists() ? fileInfo.canonicalFilePath() : QString();
-    const QString resolvedPath = canonicalPath.isEmpty() ? absolutePath : canonicalPath;
+    QElapsedTimer timer;
+    timer.start();
+    const QString localPath = url.toLocalFile();
+    bool allowed = false;
+    bool cached = false;
+    QString root;
+    quint64 generation = 0;
+    {
+      QReadLocker locker(&m_lock);
+      const auto it = m_decisions.constFind(localPath);
+      if (it != m_decisions.cend()) {
+        allowed = it.value();
+        cached = true;
+      }
+      root = m_rootAbsolute;
+      generation = m_generation;
+    }
 
-    if (resolvedPath.isEmpty() || !resolvedPath.startsWith(m_rootAbsolute)) {
-      info.block(true);
-      qWarning() << "WebHost blocked file request:" << url << "resolved to" << resolvedPath;
-      return;
+    if (!cached) {
+      QString resolvedPath;
+      allowed = resolve(localPath, root, &resolvedPath);
+      QWriteLocker locker(&m_lock);
+      // A decision made against a root or tree that has changed since must not be cached.
+      if (m_generation == generation) {
+        m_decisions.insert(localPath, allowed);
+      }
+      if (allowed) {
+        qInfo() << "WebHost file request:" << url;
+        if (m_context && m_fileAllowed) {
+          QMetaObject::invokeMethod(
+              m_context, [handler = m_fileAllowed, path = QDir::cleanPath(localPath)]() {
+                handler(path);
+              },
+              Qt::QueuedConnection);
+        }
+      } else {
+        qWarning() << "WebHost blocked file request:" << url << "resolved to" << resolvedPath;
+      }
     }
 
-    qInfo() << "WebHost file request:" << url;
+    if (!allowed) {
+      info.block(true);
+      m_blocked.fetchAndAddRelaxed(1);
+    }
+    m_requests.fetchAndAddRelaxed(1);
+    if (cached) {
+      m_cacheHits.fetchAndAddRelaxed(1);
+    }
+    m_totalNanoseconds.fetchAndAddRelaxed(quint64(timer.nsecsElapsed()));
   }
 
 private:
-  void setRoot(const QString &rootDir) {
-    QString absolute = QDir(rootDir).absolutePath();
-    if (!absolute.endsWith(QDir::separator())) {
-      absolute += QDir::separator();
-    }
-    m_rootAbsolute = absolute;
+  static bool resolve(const QString &localPath, const QString &root, QString *resolvedPath) {
+    QFileInfo fileInfo(QDir::cleanPath(localPath));
+    const QString absolutePath = fileInfo.absoluteFilePath();
+    const QString canonicalPath = fileInfo.exists() ? fileInfo.canonicalFilePath() : QString();
+    *resolvedPath = canonicalPath.isEmpty() ? absolutePath : canonicalPath;
+    return !resolvedPath->isEmpty() && resolvedPath->startsWith(root);
   }
 
+  mutable QReadWriteLock m_lock;
   QString m_rootAbsolute;
+  QHash<QString, bool> m_decisions;
+  quint64 m_generation = 0;
+  QPointer<QObject> m_context;
+  std::function<void(const QString &)> m_fileAllowed;
+  QAtomicInteger<quint64> m_requests = 0;
+  QAtomicInteger<quint64> m_cacheHits = 0;
+  QAtomicInteger<quint64> m_blocked = 0;
+  QAtomicInteger<quint64> m_totalNanoseconds = 0;
 };
 
 class WebHostPage : public QWebEnginePage {
@@ -106,23 +209,37 @@ protected:
 
 } // namespace
 
+class HostBridge;
+
+namespace {
+
+void attachSharedHostApiObject(const QString &name, QObject *instance, HostBridge *bridge);
+void detachSharedHostApiObjects(HostBridge *bridge);
+
+} // namespace
+
 class HostBridge : public QObject {
   Q_OBJECT
   Q_PROPERTY(QStringList validEventTypes READ validEventTypes CONSTANT)
   Q_PROPERTY(QString hostApiVersion READ hostApiVersion CONSTANT)
-  Q_PROPERTY(QJsonObject hostApiSchema READ hostApiSchema CONSTANT)
+  // Only the hash goes into the channel's init message; the page fetches the schema on demand.
+  Q_PROPERTY(QString hostApiSchemaHash READ hostApiSchemaHash CONSTANT)
 
 public:
   explicit HostBridge(const QStringList &validEventTypes, const QString &hostApiVersion,
-                      const QJsonObject &hostApiSchema, QObject *parent = nullptr)
+                      const QString &hostApiSchemaHash, QObject *parent = nullptr)
       : QObject(parent),
         m_validEventTypes(validEventTypes),
         m_hostApiVersion(hostApiVersion),
-        m_hostApiSchema(hostApiSchema) {}
+        m_hostApiSchemaHash(hostApiSchemaHash),
+        m_eventSubscribers(validEventTypes.size(), -1) {}
 
   QStringList validEventTypes() const { return m_validEventTypes; }
   QString hostApiVersion() const { return m_hostApiVersion; }
-  QJsonObject hostApiSchema() const { return m_hostApiSchema; }
+  QString hostApiSchemaHash() const { return m_hostApiSchemaHash; }
+
+  // The generated JSON text, so the page parses it once instead of receiving a QJsonObject.
+  Q_INVOKABLE QString fetchHostApiSchema() const { return QString::fromUtf8(hostApiSchemaJson()); }
 
   Q_INVOKABLE void sendData(const QVariant &data) {
     emit sendDataRequested(QJsonValue::fromVariant(data));
@@ -136,24 +253,248 @@ public:
     return uuid;
   }
 
+  // Called by the bootstrap after HostApiReady listeners ran, so the subscriber counts they
+  // reported arrive first.
+  Q_INVOKABLE void notifyHostApiReady(const QString &version) { emit hostApiReady(version); }
+
+  // eventId is the HostApiEvent value, i.e. the index into validEventTypes.
+  Q_INVOKABLE void setEventSubscriberCount(int eventId, int count) {
+    if (eventId >= 0 && eventId < m_eventSubscribers.size()) {
+      m_eventSubscribers[eventId] = qMax(0, count);
+    }
+  }
+
+  bool hasEventSubscribers(int eventId) const {
+    return eventId >= 0 && eventId < m_eventSubscribers.size() && m_eventSubscribers[eventId] > 0;
+  }
+  // Event types the page has not reported on yet (-1) are delivered, so a listener added just
+  // before the event is triggered does not miss it while its count is on the way.
+  bool wantsEvent(int eventId) const {
+    return eventId >= 0 && eventId < m_eventSubscribers.size() && m_eventSubscribers[eventId] != 0;
+  }
+
+  void clearEventSubscribers() { m_eventSubscribers.fill(-1); }
+
+  // Lazy objects are constructed as children of owner.
+  void setHostApiObjects(const QList<HostApiObjectInfo> &objects, QObject *owner) {
+    m_hostApiObjects.clear();
+    m_hostApiObjectOwner = owner;
+    for (const auto &object : objects) {
+      m_hostApiObjects.insert(object.name, object);
+    }
+  }
+
+  // Blocks until threaded calls into this host's own HostApi objects have returned, so deleting
+  // their owner cannot pull an object out from under a worker.
+  void drainThreadedCalls() {
+    QList<HostApiObjectInfo> owned;
+    for (const auto &object : std::as_const(m_hostApiObjects)) {
+      if (object.instance && !object.shared) {
+        owned.append(object);
+      }
+    }
+    waitForHostApiCalls(owned);
+  }
+
+  // Hands a HostApi object to the page, constructing it on first use; the channel publishes the
+  // returned QObject so its signals can be connected.
+  Q_INVOKABLE QObject *hostApiObject(const QString &name) { return ensureHostApiObject(name); }
+
+  // Subscribes the page to the signals of a HOSTAPI_SHARED object, which reach it through
+  // hostApiSignal instead of a per-channel QObject.
+  Q_INVOKABLE bool attachHostApiObject(const QString &name) {
+    QObject *instance = ensureHostApiObject(name);
+    if (!instance || !m_hostApiObjects.value(name).shared) {
+      return false;
+    }
+    attachSharedHostApiObject(name, instance, this);
+    return true;
+  }
+
+  // Typed RPC entry point for callers that name the method. Replies arrive through
+  // rpcResolved/rpcRejected keyed by the caller-chosen callId, so calls can be pipelined.
+  Q_INVOKABLE void rpcCall(int callId, const QString &objectName, const QString &method,
+                           const QJsonArray &args) {
+    startRpc(callId, objectName,
+             [&](const HostApiObjectInfo &object, const HostApiRpcCallback &done) {
+               return invokeHostApiMethod(object, method, args, done);
+             });
+  }
+
+  // Fast path used by the generated HostApi wrappers: methodIndex selects the case of the
+  // generated dispatch switch, so no method name is compared or boxed into a QVariant.
+  Q_INVOKABLE void rpcCallIndexed(int callId, const QString &objectName, int methodIndex,
+                                  const QJsonArray &args) {
+    startRpc(callId, objectName,
+             [&](const HostApiObjectInfo &object, const HostApiRpcCallback &done) {
+               return invokeHostApiMethodIndex(object, methodIndex, args, done);
+             });
+  }
+
+  Q_INVOKABLE void rpcCancel(int callId) {
+    const HostApiRpcCancel cancel = m_pendingRpcs.take(callId);
+    if (cancel) {
+      cancel();
+    }
+  }
+
+  void cancelPendingRpcs() {
+    const QHash<int, HostApiRpcCancel> pending = std::exchange(m_pendingRpcs, {});
+    for (const auto &cancel : pending) {
+      cancel();
+    }
+  }
+
   void notifyInputProvided(const QString &uuid, const QString &input) {
     emit inputProvided(uuid, input);
   }
 
+  void notifyEvent(int eventId, const QJsonValue &payload) { emit eventDispatched(eventId, payload); }
+
+  void notifyEvents(const QJsonArray &events) { emit eventsDispatched(events); }
+
+  void notifyHostApiSignal(const QString &objectName, const QString &signalName,
+                           const QString &argsJson) {
+    emit hostApiSignal(objectName, signalName, argsJson);
+  }
+
 signals:
   void sendDataRequested(QJsonValue value);
   void setOutputRequested(QString text);
   void inputRequested(QString uuid);
   void inputProvided(QString uuid, QString input);
+  // Events carry their HostApiEvent id; batches are arrays of [id, payload] pairs.
+  void eventDispatched(int eventId, QJsonValue payload);
+  void eventsDispatched(QJsonArray events);
+  void hostApiReady(QString version);
+  void rpcResolved(int callId, QJsonValue value);
+  void rpcRejected(int callId, QJsonObject error);
+  // Arguments arrive as JSON text, converted once per emission for all attached pages.
+  void hostApiSignal(QString objectName, QString signalName, QString argsJson);
 
 private:
+  static QJsonObject rpcError(const QString &code, const QString &message) {
+    QJsonObject error;
+    error.insert(QStringLiteral("code"), code);
+    error.insert(QStringLiteral("message"), message);
+    return error;
+  }
+
+  QObject *ensureHostApiObject(const QString &name) {
+    const auto it = m_hostApiObjects.find(name);
+    if (it == m_hostApiObjects.end()) {
+      return nullptr;
+    }
+    if (!it->instance && it->create) {
+      it->instance = it->create(m_hostApiObjectOwner);
+      qInfo() << "WebHost constructed HostApi object:" << name;
+    }
+    return it->instance;
+  }
+
+  template <typename Invoke>
+  void startRpc(int callId, const QString &objectName, Invoke invoke) {
+    if (!ensureHostApiObject(objectName)) {
+      emit rpcRejected(callId, rpcError(QStringLiteral("unknown_object"),
+                                        QStringLiteral("Unknown HostApi object ") + objectName));
+      return;
+    }
+
+    const HostApiObjectInfo &object = *m_hostApiObjects.constFind(objectName);
+    const QPointer<HostBridge> self(this);
+    const HostApiRpcCancel cancel = invoke(object, [self, callId](const HostApiRpcResult &result) {
+      if (self) {
+        self->finishRpc(callId, result);
+      }
+    });
+    if (cancel) {
+      m_pendingRpcs.insert(callId, cancel);
+    }
+  }
+
+  void finishRpc(int callId, const HostApiRpcResult &result) {
+    m_pendingRpcs.remove(callId);
+    if (result.ok) {
+      emit rpcResolved(callId, result.value);
+    } else {
+      emit rpcRejected(callId, rpcError(result.errorCode, result.errorMessage));
+    }
+  }
+
   QStringList m_validEventTypes;
   QString m_hostApiVersion;
-  QJsonObject m_hostApiSchema;
+  QString m_hostApiSchemaHash;
+  QList<int> m_eventSubscribers;
+  QHash<QString, HostApiObjectInfo> m_hostApiObjects;
+  QObject *m_hostApiObjectOwner = nullptr;
+  QHash<int, HostApiRpcCancel> m_pendingRpcs;
 };
 
 namespace {
 
+// Relays the signals of each HOSTAPI_SHARED object to the bridges of every page that attached to
+// it. The arguments are converted to JSON text once per emission; each channel still embeds that
+// text in its own message, which its page parses. Pages are detached when their next load starts.
+struct SharedHostApiRelay {
+  QPointer<QObject> instance;
+  QList<QPointer<HostBridge>> bridges;
+};
+
+QHash<QString, SharedHostApiRelay> &sharedHostApiRelays() {
+  static QHash<QString, SharedHostApiRelay> relays;
+  return relays;
+}
+
+void attachSharedHostApiObject(const QString &name, QObject *instance, HostBridge *bridge) {
+  SharedHostApiRelay &relay = sharedHostApiRelays()[name];
+  if (relay.instance != instance) {
+    relay.instance = instance;
+    relay.bridges.clear();
+    relayHostApiSignals(name, instance, [name](const QString &signal, const QJsonArray &args) {
+      const QString argsJson =
+          QString::fromUtf8(QJsonDocument(args).toJson(QJsonDocument::Compact));
+      auto &bridges = sharedHostApiRelays()[name].bridges;
+      bridges.removeAll(nullptr);
+      // Copy: a slot connected to a bridge may attach another page.
+      const QList<QPointer<HostBridge>> targets = bridges;
+      for (const auto &target : targets) {
+        if (target) {
+          target->notifyHostApiSignal(name, signal, argsJson);
+        }
+      }
+    });
+  }
+  if (!relay.bridges.contains(bridge)) {
+    relay.bridges.append(bridge);
+  }
+}
+
+void detachSharedHostApiObjects(HostBridge *bridge) {
+  auto &relays = sharedHostApiRelays();
+  for (auto it = relays.begin(); it != relays.end(); ++it) {
+    it->bridges.removeAll(bridge);
+  }
+}
+
+constexpr char kHostApiBootstrapScriptName[] = "WebHostHostApiBootstrap";
+constexpr int kMaxPreReadyEvents = 256;
+
+QString webChannelScriptSource() {
+  static QString source;
+  static bool loaded = false;
+  if (loaded) {
+    return source;
+  }
+  QFile file(QStringLiteral(":/qtwebchannel/qwebchannel.js"));
+  if (file.open(QIODevice::ReadOnly)) {
+    source = QString::fromUtf8(file.readAll());
+  } else {
+    qWarning() << "WebHost failed to read qwebchannel.js from Qt resources.";
+  }
+  loaded = true;
+  return source;
+}
+
 QString jsonValueToJs(const QJsonValue &value) {
   QJsonArray wrapper;
   if (value.isUndefined()) {
@@ -195,6 +536,42 @@ QString resolveWebRoot(const QString &preferredRoot) {
   return QDir(preferredRoot).absolutePath();
 }
 
+WebHost::ProfileMode &defaultProfileModeRef() {
+  static WebHost::ProfileMode mode = WebHost::ProfileMode::PerInstance;
+  return mode;
+}
+
+WebHost::BootstrapMode &defaultBootstrapModeRef() {
+  static WebHost::BootstrapMode mode = WebHost::BootstrapMode::DocumentCreation;
+  return mode;
+}
+
+// Profiles are released with deleteLater: a WebHost's page is its child and is deleted after the
+// WebHost's members, and a profile must not be deleted before its pages.
+QSharedPointer<QWebEngineProfile> createProfile() {
+  QSharedPointer<QWebEngineProfile> profile(new QWebEngineProfile, &QObject::deleteLater);
+  const QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  if (!appDataPath.isEmpty()) {
+    profile->setPersistentStoragePath(appDataPath);
+    profile->setCachePath(QDir(appDataPath).filePath("cache"));
+  }
+
+  // One handler per profile; every host on the profile adds its own routes to it.
+  auto *schemeHandler = new WebHostSchemeHandler(profile.data());
+  profile->installUrlSchemeHandler(WebHostSchemeHandler::schemeName(), schemeHandler);
+  return profile;
+}
+
+QSharedPointer<QWebEngineProfile> sharedProfile() {
+  static QWeakPointer<QWebEngineProfile> shared;
+  QSharedPointer<QWebEngineProfile> profile = shared.toStrongRef();
+  if (!profile) {
+    profile = createProfile();
+    shared = profile;
+  }
+  return profile;
+}
+
 } // namespace
 
 WebHost::WebHost(QWidget *parent) : WebHost(QDir::current().filePath("web"), parent) {}
@@ -206,24 +583,110 @@ WebHost::WebHost(const QString &webRoot, QWidget *parent) : QWidget(parent) {
   initialize(webRoot);
 }
 
+WebHost::~WebHost() {
+  // HostApi objects are children and die after this body; let threaded calls into them finish.
+  if (m_bridge) {
+    m_bridge->drainThreadedCalls();
+  }
+}
+
 void WebHost::registerUrlScheme() {
   static bool registered = false;
   if (registered) {
     return;
   }
 
-  QWebEngineUrlScheme scheme("webhost");
+  QWebEngineUrlScheme scheme(WebHostSchemeHandler::schemeName());
   scheme.setFlags(QWebEngineUrlScheme::LocalScheme | QWebEngineUrlScheme::LocalAccessAllowed |
-                  QWebEngineUrlScheme::SecureScheme | QWebEngineUrlScheme::ViewSourceAllowed);
+                  QWebEngineUrlScheme::SecureScheme | QWebEngineUrlScheme::ViewSourceAllowed |
+                  QWebEngineUrlScheme::CorsEnabled | QWebEngineUrlScheme::FetchApiAllowed);
   scheme.setSyntax(QWebEngineUrlScheme::Syntax::Path);
   QWebEngineUrlScheme::registerScheme(scheme);
   registered = true;
 }
 
+void WebHost::setDefaultProfileMode(ProfileMode mode) {
+  defaultProfileModeRef() = mode;
+}
+
+WebHost::ProfileMode WebHost::defaultProfileMode() {
+  return defaultProfileModeRef();
+}
+
+void WebHost::setDefaultBootstrapMode(BootstrapMode mode) {
+  defaultBootstrapModeRef() = mode;
+}
+
+WebHost::BootstrapMode WebHost::defaultBootstrapMode() {
+  return defaultBootstrapModeRef();
+}
+
+WebHost::ProfileMode WebHost::profileMode() const {
+  return m_profileMode;
+}
+
+QString WebHost::publishBlob(const QByteArray &data, const QString &mimeType,
+                             BlobLifetime lifetime) {
+  return m_blobRegistry->publish(data, mimeType.toUtf8(),
+                                 lifetime == BlobLifetime::ReleaseAfterRead);
+}
+
+QString WebHost::publishBlob(QIODevice *device, const QString &mimeType) {
+  return m_blobRegistry->publish(device, mimeType.toUtf8());
+}
+
+bool WebHost::releaseBlob(const QString &id) {
+  return m_blobRegistry->release(id);
+}
+
+QUrl WebHost::blobUrl(const QString &id) {
+  return QUrl(QStringLiteral("webhost://blob/") + id);
+}
+
+void WebHost::setUploadSink(const QString &name, QIODevice *device) {
+  m_uploadReceiver->setSink(name, device);
+}
+
+QString WebHost::openStream(qint64 highWaterMark) {
+  return m_streamRegistry->open(highWaterMark);
+}
+
+bool WebHost::writeStream(const QString &id, const QByteArray &data) {
+  return m_streamRegistry->write(id, data);
+}
+
+void WebHost::closeStream(const QString &id) {
+  m_streamRegistry->close(id);
+}
+
+bool WebHost::isStreamWritable(const QString &id) const {
+  return m_streamRegistry->isWritable(id);
+}
+
+WebHost::FileRequestStats WebHost::fileRequestStats() const {
+  return static_cast<WebRootInterceptor *>(m_interceptor)->stats();
+}
+
+void WebHost::resetFileRequestStats() {
+  static_cast<WebRootInterceptor *>(m_interceptor)->resetStats();
+}
+
 QStringList WebHost::validEventTypes() const {
   return m_validEventTypes;
 }
 
+bool WebHost::hasEventSubscribers(const QString &eventType) const {
+  return m_bridge && m_bridge->hasEventSubscribers(hostApiEventId(eventType));
+}
+
+bool WebHost::wantsEvent(const QString &eventType) const {
+  return m_bridge && m_bridge->wantsEvent(hostApiEventId(eventType));
+}
+
+bool WebHost::isHostApiReady() const {
+  return m_hostApiReady;
+}
+
 void WebHost::setRootDir(const QString &webRoot) {
   m_rootMode = RootMode::Directory;
   m_webRoot = resolveWebRoot(webRoot);
@@ -231,6 +694,10 @@ void WebHost::setRootDir(const QString &webRoot) {
     auto *interceptor = static_cast<WebRootInterceptor *>(m_interceptor);
     interceptor->setRootDir(m_webRoot);
   }
+  if (m_rootWatcher) {
+    m_loadedFiles.clear();
+    updateRootWatcher();
+  }
   if (m_page) {
     m_page->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessFileUrls, true);
     m_page->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessRemoteUrls, false);
@@ -244,6 +711,9 @@ void WebHost::setRootQrc() {
     m_qrcRoot = QStringLiteral("qrc:/web");
   }
   ensureWebResourcesRegistered();
+  if (m_rootWatcher) {
+    updateRootWatcher();
+  }
   if (m_page) {
     m_page->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessFileUrls, false);
     m_page->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessRemoteUrls, false);
@@ -251,25 +721,395 @@ void WebHost::setRootQrc() {
   loadRoot();
 }
 
+void WebHost::setRootScheme(AssetSource source) {
+  m_rootMode = RootMode::Scheme;
+  m_schemeSource = source;
+  QString sourceRoot = m_webRoot;
+  if (source == AssetSource::Qrc) {
+    ensureWebResourcesRegistered();
+    sourceRoot = QStringLiteral(":/web");
+  }
+  m_assetCache = WebAssetCache::forRoot(sourceRoot);
+  if (m_rootWatcher) {
+    updateRootWatcher();
+  }
+  if (m_page) {
+    m_page->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessFileUrls, false);
+    m_page->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessRemoteUrls, false);
+  }
+  loadRoot();
+}
+
+bool WebHost::setRootPack(const QString &packPath) {
+  QString resolvedPath = packPath;
+  if (QFileInfo(packPath).isRelative() && !QFileInfo::exists(packPath)) {
+    resolvedPath = QDir(QCoreApplication::applicationDirPath()).filePath(packPath);
+  }
+
+  QString errorString;
+  QSharedPointer<WebAssetCache> cache = WebAssetCache::forPack(resolvedPath, &errorString);
+  if (!cache) {
+    qWarning() << "WebHost failed to open asset pack" << resolvedPath << ":" << errorString;
+    return false;
+  }
+
+  m_rootMode = RootMode::Pack;
+  m_assetCache = cache;
+  if (m_rootWatcher) {
+    updateRootWatcher();
+  }
+  if (m_page) {
+    m_page->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessFileUrls, false);
+    m_page->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessRemoteUrls, false);
+  }
+  loadRoot();
+  return true;
+}
+
+void WebHost::setBootstrapMode(BootstrapMode mode) {
+  if (m_bootstrapMode == mode) {
+    return;
+  }
+  m_bootstrapMode = mode;
+  installHostApiBootstrap();
+  loadRoot();
+}
+
+WebHost::BootstrapMode WebHost::bootstrapMode() const {
+  return m_bootstrapMode;
+}
+
+void WebHost::setHotReloadEnabled(bool enabled) {
+  if (m_hotReloadEnabled == enabled) {
+    return;
+  }
+  m_hotReloadEnabled = enabled;
+  m_hotReloadPaths.clear();
+  m_hotReloadTimer->stop();
+  watchHotReloadRoot();
+}
+
+bool WebHost::isHotReloadEnabled() const {
+  return m_hotReloadEnabled;
+}
+
+void WebHost::setHotReloadDebounce(int intervalMs) {
+  m_hotReloadTimer->setInterval(qMax(0, intervalMs));
+}
+
+int WebHost::hotReloadDebounce() const {
+  return m_hotReloadTimer->interval();
+}
+
+bool WebHost::servesRootFromDisk() const {
+  return m_rootMode == RootMode::Directory ||
+         (m_rootMode == RootMode::Scheme && m_schemeSource == AssetSource::Directory);
+}
+
+void WebHost::updateRootWatcher() {
+  // Qrc, pack and Qrc-sourced scheme roots cannot change under the page, so their directory on
+  // disk is not watched at all.
+  const QString root =
+      servesRootFromDisk() && !m_webRoot.isEmpty() ? QDir(m_webRoot).absolutePath() : QString();
+  if (m_rootWatcher->root() != root) {
+    m_rootWatcher->setRoot(root);
+  }
+  watchHotReloadRoot();
+}
+
+void WebHost::watchHotReloadRoot() {
+  // The directory tree is always watched for the interceptor. Directory events report added,
+  // removed and replaced files, but not every platform reports in-place writes through them, so
+  // files the page has loaded are watched individually while hot reload is on, and while the
+  // scheme root's cache holds copies of them.
+  m_rootWatcher->unwatchFiles();
+  if (!watchesLoadedFiles()) {
+    return;
+  }
+  for (const QString &path : std::as_const(m_loadedFiles)) {
+    m_rootWatcher->watchFile(path);
+  }
+}
+
+bool WebHost::watchesLoadedFiles() const {
+  return servesRootFromDisk() && (m_hotReloadEnabled || m_rootMode == RootMode::Scheme);
+}
+
+void WebHost::noteLoadedFile(const QString &path) {
+  m_loadedFiles.insert(path);
+  if (watchesLoadedFiles() && m_rootWatcher) {
+    m_rootWatcher->watchFile(path);
+  }
+}
+
+void WebHost::flushHotReload() {
+  if (m_hotReloadPaths.isEmpty()) {
+    return;
+  }
+
+  const QDir root(m_webRoot);
+  QStringList paths;
+  for (const QString &path : std::as_const(m_hotReloadPaths)) {
+    paths.append(root.relativeFilePath(path));
+  }
+  m_hotReloadPaths.clear();
+  paths.sort();
+
+  qInfo() << "WebHost hot reload:" << paths;
+  emit signalHotReload(paths);
+  if (!m_page || m_rootMode != RootMode::Directory) {
+    return;
+  }
+
+  const QString rootUrl = QUrl::fromLocalFile(root.absolutePath() + QLatin1Char('/')).toString();
+  const QString script = QStringLiteral(
+      "if (window.HostApi && window.HostApi.__hotReload) { "
+      "window.HostApi.__hotReload(%1, %2); "
+      "} else { location.reload(); }")
+                             .arg(jsonValueToJs(QJsonArray::fromStringList(paths)),
+                                  jsonValueToJs(rootUrl));
+  m_page->runJavaScript(script);
+}
+
+void WebHost::setEventDispatchMode(EventDispatchMode mode) {
+  m_eventDispatchMode = mode;
+}
+
+WebHost::EventDispatchMode WebHost::eventDispatchMode() const {
+  return m_eventDispatchMode;
+}
+
+void WebHost::setChannelTransport(ChannelTransport transport) {
+  if (m_channelTransport == transport) {
+    return;
+  }
+  m_channelTransport = transport;
+  connectChannelTransport();
+  installHostApiBootstrap();
+  loadRoot();
+}
+
+WebHost::ChannelTransport WebHost::channelTransport() const {
+  return m_channelTransport;
+}
+
 void WebHost::slotProvideInput(QString uuid, QString input) {
   if (m_bridge) {
     m_bridge->notifyInputProvided(uuid, input);
   }
 }
 
-void WebHost::slotTriggerEvent(QString actionId, QJsonValue payload) {
-  if (!m_page) {
-    return;
+void WebHost::slotTriggerEvent(QString actionId, QJsonValue payload) {
+  if (!m_page) {
+    return;
+  }
+  if (hostApiEventId(actionId) < 0) {
+    qWarning() << "WebHost ignoring unknown event type:" << actionId;
+    return;
+  }
+
+  if (payload.isUndefined()) {
+    payload = QJsonValue::Null;
+  }
+
+  if (!m_hostApiReady) {
+    queuePreReadyEvent(actionId, payload);
+    return;
+  }
+  if (!wantsEvent(actionId)) {
+    return;
+  }
+
+  if (m_eventBatchingEnabled) {
+    enqueueEvent(actionId, payload);
+    return;
+  }
+
+  dispatchEvent(actionId, payload);
+}
+
+void WebHost::triggerEvent(HostApiEvent event, const QJsonValue &payload) {
+  slotTriggerEvent(hostApiEventName(event), payload);
+}
+
+void WebHost::slotFlushEvents() {
+  if (m_eventBatchTimer) {
+    m_eventBatchTimer->stop();
+  }
+  if (m_pendingEvents.isEmpty()) {
+    return;
+  }
+
+  QJsonArray events;
+  for (const auto &pending : std::as_const(m_pendingEvents)) {
+    if (wantsEvent(pending.first)) {
+      events.append(QJsonArray{hostApiEventId(pending.first), pending.second});
+    }
+  }
+  m_pendingEvents.clear();
+  m_pendingEventIndex.clear();
+  if (!events.isEmpty()) {
+    dispatchEventBatch(events);
+  }
+}
+
+void WebHost::setEventBatchingEnabled(bool enabled) {
+  m_eventBatchingEnabled = enabled;
+  if (!enabled) {
+    slotFlushEvents();
+  }
+}
+
+bool WebHost::isEventBatchingEnabled() const {
+  return m_eventBatchingEnabled;
+}
+
+void WebHost::setEventBatchInterval(int intervalMs) {
+  m_eventBatchIntervalMs = qMax(0, intervalMs);
+}
+
+int WebHost::eventBatchInterval() const {
+  return m_eventBatchIntervalMs;
+}
+
+void WebHost::setEventBatchPolicy(const QString &eventType, EventBatchPolicy policy) {
+  if (policy == EventBatchPolicy::DeliverAll) {
+    m_eventBatchPolicies.remove(eventType);
+    return;
+  }
+  m_eventBatchPolicies.insert(eventType, policy);
+}
+
+WebHost::EventBatchPolicy WebHost::eventBatchPolicy(const QString &eventType) const {
+  return m_eventBatchPolicies.value(eventType, EventBatchPolicy::DeliverAll);
+}
+
+void WebHost::dispatchEvent(const QString &eventType, const QJsonValue &payload) {
+  if (m_eventDispatchMode == EventDispatchMode::Channel) {
+    if (m_bridge) {
+      m_bridge->notifyEvent(hostApiEventId(eventType), payload);
+    }
+    return;
+  }
+
+  m_page->runJavaScript(eventScript(hostApiEventId(eventType), payload));
+}
+
+QString WebHost::eventScript(int eventId, const QJsonValue &payload) {
+  return QStringLiteral(
+             "if (window.HostApi && window.HostApi.__dispatchEvent) { "
+             "window.HostApi.__dispatchEvent(%1, %2); "
+             "}")
+      .arg(QString::number(eventId), jsonValueToJs(payload));
+}
+
+void WebHost::deliverPreparedEvent(PreparedEvent *event) {
+  if (!m_page) {
+    return;
+  }
+  if (!m_hostApiReady) {
+    queuePreReadyEvent(event->eventType, event->payload);
+    return;
+  }
+  if (!wantsEvent(event->eventType)) {
+    return;
+  }
+  if (m_eventBatchingEnabled) {
+    enqueueEvent(event->eventType, event->payload);
+    return;
+  }
+  if (m_eventDispatchMode == EventDispatchMode::Channel) {
+    // Each channel encodes the payload into its own message, as dispatchEvent does.
+    m_bridge->notifyEvent(event->eventId, event->payload);
+    return;
+  }
+  if (event->script.isEmpty()) {
+    event->script = eventScript(event->eventId, event->payload);
+  }
+  m_page->runJavaScript(event->script);
+}
+
+void WebHost::dispatchEventBatch(const QJsonArray &events) {
+  if (m_eventDispatchMode == EventDispatchMode::Channel) {
+    if (m_bridge) {
+      m_bridge->notifyEvents(events);
+    }
+    return;
+  }
+
+  const QString script = QStringLiteral(
+      "if (window.HostApi && window.HostApi.__dispatchEvents) { "
+      "window.HostApi.__dispatchEvents(%1); "
+      "}")
+                              .arg(jsonValueToJs(events));
+  m_page->runJavaScript(script);
+}
+
+void WebHost::enqueueEvent(const QString &eventType, const QJsonValue &payload) {
+  const EventBatchPolicy policy = eventBatchPolicy(eventType);
+  const auto pendingIt = m_pendingEventIndex.constFind(eventType);
+  if (policy == EventBatchPolicy::DeliverAll || pendingIt == m_pendingEventIndex.cend()) {
+    if (policy != EventBatchPolicy::DeliverAll) {
+      m_pendingEventIndex.insert(eventType, m_pendingEvents.size());
+    }
+    m_pendingEvents.append({eventType, payload});
+  } else {
+    QJsonValue &queued = m_pendingEvents[pendingIt.value()].second;
+    if (policy == EventBatchPolicy::MergePayloads && queued.isObject() && payload.isObject()) {
+      QJsonObject merged = queued.toObject();
+      const QJsonObject update = payload.toObject();
+      for (auto it = update.begin(); it != update.end(); ++it) {
+        merged.insert(it.key(), it.value());
+      }
+      queued = merged;
+    } else {
+      queued = payload;
+    }
+  }
+
+  if (m_eventBatchTimer && !m_eventBatchTimer->isActive()) {
+    m_eventBatchTimer->start(eventBatchTimerInterval());
+  }
+}
+
+void WebHost::queuePreReadyEvent(const QString &eventType, const QJsonValue &payload) {
+  if (hostApiEventId(eventType) < 0) {
+    return;
+  }
+  if (m_preReadyEvents.size() >= kMaxPreReadyEvents) {
+    m_preReadyEvents.removeFirst();
+    if (m_preReadyDropped++ == 0) {
+      qWarning() << "WebHost event queue full before HostApi is ready; dropping oldest events.";
+    }
+  }
+  m_preReadyEvents.append({eventType, payload});
+}
+
+void WebHost::flushPreReadyEvents() {
+  const QList<QPair<QString, QJsonValue>> queued = std::exchange(m_preReadyEvents, {});
+  if (m_preReadyDropped > 0) {
+    qWarning() << "WebHost dropped" << m_preReadyDropped << "events before HostApi was ready.";
+    m_preReadyDropped = 0;
   }
 
-  const QString actionIdJs = jsonValueToJs(QJsonValue(actionId));
-  const QString payloadJs = jsonValueToJs(payload);
-  const QString script = QStringLiteral(
-      "if (window.HostApi && window.HostApi.__dispatchEvent) { "
-      "window.HostApi.__dispatchEvent(%1, %2); "
-      "}")
-                              .arg(actionIdJs, payloadJs);
-  m_page->runJavaScript(script);
+  QJsonArray events;
+  for (const auto &event : queued) {
+    if (wantsEvent(event.first)) {
+      events.append(QJsonArray{hostApiEventId(event.first), event.second});
+    }
+  }
+  if (!events.isEmpty()) {
+    dispatchEventBatch(events);
+  }
+}
+
+int WebHost::eventBatchTimerInterval() const {
+  if (m_eventBatchIntervalMs > 0) {
+    return m_eventBatchIntervalMs;
+  }
+  const QScreen *hostScreen = screen();
+  const qreal refreshRate = hostScreen ? hostScreen->refreshRate() : 60.0;
+  return qMax(1, qRound(1000.0 / (refreshRate > 0 ? refreshRate : 60.0)));
 }
 
 void WebHost::applyWindowBackground() {
@@ -303,43 +1143,141 @@ void WebHost::initialize(const QString &webRoot) {
   qInfo() << "WebHost resolved web root:" << m_webRoot;
 
   m_view = new QWebEngineView(this);
-  m_profile = new QWebEngineProfile(this);
-  const QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-  if (!appDataPath.isEmpty()) {
-    m_profile->setPersistentStoragePath(appDataPath);
-    m_profile->setCachePath(QDir(appDataPath).filePath("cache"));
-  }
-
-  m_interceptor = new WebRootInterceptor(m_webRoot, m_profile);
-  m_profile->setUrlRequestInterceptor(m_interceptor);
-
-  m_page = new WebHostPage(m_profile, this);
+  m_profileMode = defaultProfileModeRef();
+  m_bootstrapMode = defaultBootstrapModeRef();
+  m_profile = m_profileMode == ProfileMode::Shared ? sharedProfile() : createProfile();
+  m_schemeHandler = m_profile->findChild<WebHostSchemeHandler *>();
+
+  m_page = new WebHostPage(m_profile.data(), this);
+  // The interceptor is installed on the page rather than the profile so that hosts sharing a
+  // profile still confine file:// requests to their own roots.
+  auto *interceptor = new WebRootInterceptor(m_webRoot, m_page);
+  interceptor->setFileAllowedHandler(this, [this](const QString &path) { noteLoadedFile(path); });
+  m_interceptor = interceptor;
+  m_page->setUrlRequestInterceptor(m_interceptor);
   m_page->settings()->setAttribute(QWebEngineSettings::ErrorPageEnabled, true);
   m_page->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessFileUrls,
                                    m_rootMode == RootMode::Directory);
   m_page->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessRemoteUrls, false);
   m_channel = new QWebChannel(this);
 
-  registerHostApiObjects(m_channel, this);
-  m_bridge = new HostBridge(m_validEventTypes, hostApiVersion(), hostApiSchema(), this);
+  m_eventBatchTimer = new QTimer(this);
+  m_eventBatchTimer->setSingleShot(true);
+  m_eventBatchTimer->setTimerType(Qt::PreciseTimer);
+  connect(m_eventBatchTimer, &QTimer::timeout, this, &WebHost::slotFlushEvents);
+
+  m_hotReloadTimer = new QTimer(this);
+  m_hotReloadTimer->setSingleShot(true);
+  m_hotReloadTimer->setInterval(100);
+  connect(m_hotReloadTimer, &QTimer::timeout, this, &WebHost::flushHotReload);
+  // One watcher over the root serves both the interceptor's decision cache and hot reload.
+  m_rootWatcher = new WebRootWatcher(this);
+  updateRootWatcher();
+  connect(m_rootWatcher, &WebRootWatcher::directoryChanged, this, [this]() {
+    static_cast<WebRootInterceptor *>(m_interceptor)->invalidate();
+  });
+  connect(m_rootWatcher, &WebRootWatcher::filesChanged, this, [this](const QStringList &paths) {
+    if (m_rootMode == RootMode::Scheme && m_assetCache) {
+      m_assetCache->evict(paths);
+    }
+    if (!m_hotReloadEnabled) {
+      return;
+    }
+    for (const QString &path : paths) {
+      m_hotReloadPaths.insert(path);
+    }
+    m_hotReloadTimer->start();
+  });
+
+  const QList<HostApiObjectInfo> hostApiObjects = registerHostApiObjects(m_channel, this);
+  m_bridge = new HostBridge(m_validEventTypes, hostApiVersion(), hostApiSchemaHash(), this);
+  m_bridge->setHostApiObjects(hostApiObjects, this);
 
-  m_page->setWebChannel(m_channel);
   m_channel->registerObject("HostBridge", m_bridge);
 
+  m_cborTransport = new CborChannelTransport(this);
+  m_schemeHandler->addRoute(QStringLiteral("channel"), m_cborTransport,
+                            [transport = m_cborTransport](QWebEngineUrlRequestJob *job,
+                                                          const QString &path) {
+                              return transport->handleRequest(job, path);
+                            });
+  connectChannelTransport();
+
+  m_blobRegistry = new WebHostBlobRegistry(this);
+  m_schemeHandler->addRoute(QStringLiteral("blob"), m_blobRegistry,
+                            [registry = m_blobRegistry](QWebEngineUrlRequestJob *job,
+                                                        const QString &path) {
+                              return registry->handleRequest(job, path);
+                            });
+  connect(m_blobRegistry, &WebHostBlobRegistry::released, this, &WebHost::signalBlobReleased);
+
+  m_schemeHandler->addRoute(QStringLiteral("app"), this,
+                            [this](QWebEngineUrlRequestJob *job, const QString &path) {
+                              QString filePath;
+                              if (!m_assetCache ||
+                                  !m_assetCache->handleRequest(job, path, &filePath)) {
+                                return false;
+                              }
+                              if (!filePath.isEmpty()) {
+                                noteLoadedFile(filePath);
+                              }
+                              return true;
+                            });
+
+  m_uploadReceiver = new WebHostUploadReceiver(this);
+  m_schemeHandler->addRoute(QStringLiteral("upload"), m_uploadReceiver,
+                            [receiver = m_uploadReceiver](QWebEngineUrlRequestJob *job,
+                                                          const QString &path) {
+                              return receiver->handleRequest(job, path);
+                            });
+  connect(m_uploadReceiver, &WebHostUploadReceiver::started, this,
+          &WebHost::signalUploadStarted);
+  connect(m_uploadReceiver, &WebHostUploadReceiver::chunkReceived, this,
+          &WebHost::signalUploadChunk);
+  connect(m_uploadReceiver, &WebHostUploadReceiver::finished, this,
+          &WebHost::signalUploadFinished);
+
+  m_streamRegistry = new WebHostStreamRegistry(this);
+  m_schemeHandler->addRoute(QStringLiteral("stream"), m_streamRegistry,
+                            [registry = m_streamRegistry](QWebEngineUrlRequestJob *job,
+                                                          const QString &path) {
+                              return registry->handleRequest(job, path);
+                            });
+  connect(m_streamRegistry, &WebHostStreamRegistry::writable, this,
+          &WebHost::signalStreamWritable);
+  connect(m_streamRegistry, &WebHostStreamRegistry::cancelled, this,
+          &WebHost::signalStreamCancelled);
+
   connect(m_bridge, &HostBridge::sendDataRequested, this, &WebHost::signalSendData);
   connect(m_bridge, &HostBridge::setOutputRequested, this, &WebHost::signalSetOutput);
   connect(m_bridge, &HostBridge::inputRequested, this, &WebHost::signalGetInput);
-  connect(m_page, &QWebEnginePage::loadStarted, this,
-          [this]() { qInfo() << "WebHost load started:" << m_page->url(); });
+  connect(m_bridge, &HostBridge::hostApiReady, this, [this](const QString &version) {
+    m_hostApiReady = true;
+    // Queued events go out before anything a signalHostApiReady slot triggers.
+    flushPreReadyEvents();
+    emit signalHostApiReady(version);
+  });
+  connect(m_page, &QWebEnginePage::loadStarted, this, [this]() {
+    qInfo() << "WebHost load started:" << m_page->url();
+    m_hostApiReady = false;
+    m_bridge->clearEventSubscribers();
+    m_bridge->cancelPendingRpcs();
+    // The new page attaches again when it first touches a shared object.
+    detachSharedHostApiObjects(m_bridge);
+    m_cborTransport->reset();
+    m_streamRegistry->cancelAll();
+  });
   connect(m_page, &QWebEnginePage::loadFinished, this, [this](bool ok) {
     qInfo() << "WebHost load finished:" << ok << "url:" << m_page->url();
     applyWindowBackground();
-    if (ok) {
+    if (ok && m_bootstrapMode == BootstrapMode::LoadFinished) {
       injectHostApiBootstrap();
     }
+    emit signalLoadFinished(ok);
   });
 
   m_view->setPage(m_page);
+  installHostApiBootstrap();
 
   auto *layout = new QVBoxLayout(this);
   layout->setContentsMargins(0, 0, 0, 0);
@@ -353,6 +1291,11 @@ void WebHost::loadRoot() {
     return;
   }
 
+  if ((m_rootMode == RootMode::Scheme || m_rootMode == RootMode::Pack) && m_assetCache) {
+    m_page->setUrl(QUrl(m_assetCache->baseUrl() + QStringLiteral("index.html")));
+    return;
+  }
+
   if (m_rootMode == RootMode::Qrc) {
     const QString qrcRoot = m_qrcRoot.isEmpty() ? QStringLiteral("qrc:/web") : m_qrcRoot;
     const QString urlText = qrcRoot.endsWith('/') ? qrcRoot + "index.html"
@@ -370,13 +1313,64 @@ void WebHost::loadRoot() {
   m_page->setUrl(QUrl::fromLocalFile(indexInfo.absoluteFilePath()));
 }
 
+void WebHost::connectChannelTransport() {
+  if (m_channelTransport == ChannelTransport::Cbor) {
+    m_page->setWebChannel(nullptr);
+    m_channel->connectTo(m_cborTransport);
+    return;
+  }
+  m_channel->disconnectFrom(m_cborTransport);
+  m_page->setWebChannel(m_channel);
+}
+
 void WebHost::injectHostApiBootstrap() {
   if (!m_page) {
     return;
   }
 
-  const QString script = QStringLiteral(R"JS(
-(function () {
+  m_page->runJavaScript(hostApiBootstrapScript());
+}
+
+void WebHost::installHostApiBootstrap() {
+  if (!m_page) {
+    return;
+  }
+
+  QWebEngineScriptCollection &scripts = m_page->scripts();
+  const QString name = QString::fromLatin1(kHostApiBootstrapScriptName);
+  for (const QWebEngineScript &existing : scripts.find(name)) {
+    scripts.remove(existing);
+  }
+
+  if (m_bootstrapMode != BootstrapMode::DocumentCreation) {
+    return;
+  }
+
+  // qwebchannel.js is prepended so the bootstrap does not have to append a <script> element,
+  // which is not possible before the document element exists.
+  QWebEngineScript script;
+  script.setName(name);
+  script.setInjectionPoint(QWebEngineScript::DocumentCreation);
+  script.setWorldId(QWebEngineScript::MainWorld);
+  script.setRunsOnSubFrames(false);
+  script.setSourceCode(webChannelScriptSource() + QLatin1Char('\n') + hostApiBootstrapScript());
+  scripts.insert(script);
+}
+
+QString WebHost::hostApiBootstrapScript() const {
+  QJsonObject config;
+  if (m_channelTransport == ChannelTransport::Cbor && m_cborTransport) {
+    config.insert(QStringLiteral("transport"), QStringLiteral("cbor"));
+    config.insert(QStringLiteral("channelUrl"), m_cborTransport->baseUrl());
+  } else {
+    config.insert(QStringLiteral("transport"), QStringLiteral("json"));
+  }
+  if (m_uploadReceiver) {
+    config.insert(QStringLiteral("uploadUrl"), m_uploadReceiver->baseUrl());
+  }
+
+  QString script = QStringLiteral(R"JS(
+(function (config, hostApiWrappers) {
 
   function logError(message) {
     try {
@@ -386,19 +1380,30 @@ void WebHost::injectHostApiBootstrap() {
     }
   }
 
-  function safeParseSchema(rawSchema) {
-    if (!rawSchema) {
-      return {};
+  var schemaCachePrefix = "WebHostHostApiSchema:";
+
+  // Schemas are cached in localStorage under their hash; older entries are dropped on write.
+  function readCachedSchema(hash) {
+    try {
+      var text = hash ? window.localStorage.getItem(schemaCachePrefix + hash) : null;
+      return text ? JSON.parse(text) : null;
+    } catch (e) {
+      return null;
     }
-    if (typeof rawSchema === "string") {
-      try {
-        return JSON.parse(rawSchema);
-      } catch (e) {
-        logError("Failed to parse HostApi schema.");
-        return {};
+  }
+
+  function writeCachedSchema(hash, text) {
+    try {
+      for (var i = window.localStorage.length - 1; i >= 0; i--) {
+        var key = window.localStorage.key(i);
+        if (key && key.indexOf(schemaCachePrefix) === 0) {
+          window.localStorage.removeItem(key);
+        }
       }
+      window.localStorage.setItem(schemaCachePrefix + hash, text);
+    } catch (e) {
+      // Storage is unavailable for opaque origins; the schema is then fetched once per load.
     }
-    return rawSchema;
   }
 
   function parseMajor(version) {
@@ -433,94 +1438,322 @@ void WebHost::injectHostApiBootstrap() {
     }
   }
 
+  // Set through HostApi.setHotReloadHandler; see hotReload.
+  var hotReloadHandler = null;
+
+  // Applies a hot reload from the host. paths are relative to rootUrl. Stylesheets are swapped in
+  // place. Other loaded files go to the page's hot reload handler, if it registered one, and the
+  // page reloads unless the handler returns true; scripts are never replaced by the bootstrap.
+  function hotReload(paths, rootUrl) {
+    var stamp = Date.now();
+    var loaded = {};
+    var pending = [];
+    var rootPath = urlPath(rootUrl);
+
+    function urlPath(url) {
+      try {
+        return decodeURIComponent(new URL(url, location.href).pathname);
+      } catch (e) {
+        return "";
+      }
+    }
+
+    // Compares full root-relative paths, so "styles.css" does not match "sub/styles.css".
+    function matches(url, path) {
+      var pathname = urlPath(url);
+      return pathname.indexOf(rootPath) === 0 && pathname.slice(rootPath.length) === path;
+    }
+
+    function isLoaded(path) {
+      if (matches(location.href, path)) {
+        return true;
+      }
+      return Object.keys(loaded).some(function (url) {
+        return matches(url, path);
+      });
+    }
+
+    function swapStylesheet(path) {
+      var swapped = false;
+      var links = document.querySelectorAll("link[rel~='stylesheet']");
+      Array.prototype.forEach.call(links, function (link) {
+        if (!matches(link.href, path)) {
+          return;
+        }
+        var url = new URL(link.href);
+        url.searchParams.set("hot", String(stamp));
+        var replacement = link.cloneNode(false);
+        replacement.href = url.toString();
+        // Remove the old sheet only once the new one applies, so the page does not flash.
+        replacement.onload = replacement.onerror = function () {
+          if (link.parentNode) {
+            link.parentNode.removeChild(link);
+          }
+        };
+        link.parentNode.insertBefore(replacement, link.nextSibling);
+        swapped = true;
+      });
+      return swapped;
+    }
+
+    if (window.performance && performance.getEntriesByType) {
+      performance.getEntriesByType("resource").forEach(function (entry) {
+        loaded[entry.name] = true;
+      });
+    }
+    Array.prototype.forEach.call(document.scripts, function (script) {
+      if (script.src) {
+        loaded[script.src] = true;
+      }
+    });
+
+    paths.forEach(function (path) {
+      if (/\.map$/.test(path)) {
+        return;
+      }
+      if (/\.css$/.test(path) && swapStylesheet(path)) {
+        return;
+      }
+      if (isLoaded(path)) {
+        pending.push(path);
+      }
+    });
+
+    if (pending.length === 0) {
+      return;
+    }
+    var handled = false;
+    if (hotReloadHandler) {
+      try {
+        handled = hotReloadHandler(pending) === true;
+      } catch (e) {
+        logError("HostApi hot reload handler failed: " + e);
+      }
+    }
+    if (!handled) {
+      location.reload();
+    }
+  }
+
   if (window.HostApi && window.HostApi.__ready) {
     dispatchCustomEvent("HostApiReady", {
       version: window.HostApi.version,
-      schema: window.HostApi.schema
+      schema: window.HostApi.schema,
+      schemaHash: window.HostApi.schemaHash
     });
     return;
   }
 
-  function wrapObject(rawObject, objectInfo) {
-    var wrapped = {};
-    var methods = objectInfo.methods || [];
-    var signals = (objectInfo.signals || []).map(function (entry) {
-      return entry && entry.name ? entry.name : entry;
-    });
+  function createRpc(bridge) {
+    var nextCallId = 1;
+    var pending = {};
 
-    methods.forEach(function (methodInfo) {
-      if (!methodInfo || !methodInfo.name || typeof rawObject[methodInfo.name] !== "function") {
+    function makeError(error, callId) {
+      var err = new Error((error && error.message) || "HostApi call failed.");
+      err.name = "HostApiError";
+      err.code = (error && error.code) || "failed";
+      err.callId = callId;
+      return err;
+    }
+
+    function settle(callId) {
+      var entry = pending[callId];
+      if (!entry) {
+        return null;
+      }
+      delete pending[callId];
+      if (entry.timer) {
+        clearTimeout(entry.timer);
+      }
+      if (entry.signal && entry.onAbort) {
+        entry.signal.removeEventListener("abort", entry.onAbort);
+      }
+      return entry;
+    }
+
+    function cancel(callId, code, message) {
+      var entry = settle(callId);
+      if (!entry) {
         return;
       }
-      wrapped[methodInfo.name] = function () {
-        var args = Array.prototype.slice.call(arguments);
-        if (methodInfo.returnsVoid) {
-          rawObject[methodInfo.name].apply(rawObject, args);
-          return Promise.resolve();
-        }
-        return new Promise(function (resolve) {
-          args.push(function (result) {
-            resolve(result);
-          });
-          rawObject[methodInfo.name].apply(rawObject, args);
-        });
-      };
-    });
+      bridge.rpcCancel(callId);
+      entry.reject(makeError({ code: code, message: message }, callId));
+    }
 
-    wrapped.registerEventHandler = function (eventName, handler) {
-      if (signals.indexOf(eventName) === -1) {
-        throw new Error("eventType " + eventName + " not found.");
+    bridge.rpcResolved.connect(function (callId, value) {
+      var entry = settle(callId);
+      if (entry) {
+        entry.resolve(value);
       }
-      if (rawObject[eventName] && typeof rawObject[eventName].connect === "function") {
-        rawObject[eventName].connect(handler);
+    });
+
+    bridge.rpcRejected.connect(function (callId, error) {
+      var entry = settle(callId);
+      if (entry) {
+        entry.reject(makeError(error, callId));
       }
+    });
+
+    // methodIndex comes from the generated wrappers and selects rpcCallIndexed; without one the
+    // call is resolved by name.
+    return function call(objectName, methodName, methodIndex, args, options) {
+      var opts = options || {};
+      var callName = objectName + "." + methodName;
+      return new Promise(function (resolve, reject) {
+        var callId = nextCallId++;
+        if (opts.signal && opts.signal.aborted) {
+          reject(makeError({ code: "aborted", message: callName + " was aborted." }, callId));
+          return;
+        }
+        var entry = { resolve: resolve, reject: reject, signal: opts.signal, timer: null, onAbort: null };
+        pending[callId] = entry;
+        if (opts.timeoutMs > 0) {
+          entry.timer = setTimeout(function () {
+            cancel(callId, "timeout", callName + " timed out after " + opts.timeoutMs + " ms.");
+          }, opts.timeoutMs);
+        }
+        if (opts.signal) {
+          entry.onAbort = function () {
+            cancel(callId, "aborted", callName + " was aborted.");
+          };
+          opts.signal.addEventListener("abort", entry.onAbort);
+        }
+        if (typeof methodIndex === "number" && bridge.rpcCallIndexed) {
+          bridge.rpcCallIndexed(callId, objectName, methodIndex, args);
+        } else {
+          bridge.rpcCall(callId, objectName, methodName, args);
+        }
+      });
     };
+  }
 
-    wrapped.removeEventHandler = function (eventName, handler) {
-      if (signals.indexOf(eventName) === -1) {
-        throw new Error("eventType " + eventName + " not found.");
+  // wrapper is this object's entry in the generated wrapper table. Without a rawObject,
+  // loadRawObject fetches it from the host. Handler changes wait for it, and calls made while one
+  // is waiting queue behind it so the signals they trigger are not missed.
+  function wrapObject(rawObject, name, wrapper, rpc, loadRawObject) {
+    var waiting = [];
+
+    function withRawObject(action) {
+      if (rawObject) {
+        action(rawObject);
+      } else {
+        waiting.push(action);
       }
-      if (rawObject[eventName] && typeof rawObject[eventName].disconnect === "function") {
-        rawObject[eventName].disconnect(handler);
+    }
+
+    var wrapped = wrapper.f({
+      c: function (methodName, methodIndex, args, options) {
+        if (waiting.length === 0) {
+          return rpc(name, methodName, methodIndex, args, options);
+        }
+        return new Promise(function (resolve) {
+          waiting.push(function () {
+            resolve(rpc(name, methodName, methodIndex, args, options));
+          });
+        });
+      },
+      h: function (signals, eventName, handler, connect) {
+        if (signals[eventName] !== 1) {
+          throw new Error("eventType " + eventName + " not found.");
+        }
+        withRawObject(function (raw) {
+          var signal = raw ? raw[eventName] : null;
+          var method = signal ? signal[connect ? "connect" : "disconnect"] : null;
+          if (typeof method === "function") {
+            method.call(signal, handler);
+          }
+        });
       }
-    };
+    });
 
     wrapped.__raw = rawObject;
+    if (!rawObject && loadRawObject) {
+      loadRawObject(function (raw) {
+        if (!raw) {
+          logError("HostApi object missing: " + name);
+        }
+        rawObject = raw;
+        wrapped.__raw = raw;
+        waiting.splice(0).forEach(function (action) {
+          action(raw);
+        });
+      });
+    }
     return wrapped;
   }
 
-  function buildHostApi(bridge, schema, channel) {
-    var listeners = {};
+  function buildHostApi(bridge, channel) {
     var pendingInputs = {};
     var bufferedInputs = {};
     var validEventTypes = bridge.validEventTypes || [];
     var hostApiVersion = bridge.hostApiVersion || "0.0.0";
+    var schemaHash = bridge.hostApiSchemaHash || "";
+    var schema = readCachedSchema(schemaHash);
+    var schemaRequest = null;
+
+    function loadSchema() {
+      if (schema) {
+        return Promise.resolve(schema);
+      }
+      if (!schemaRequest) {
+        schemaRequest = new Promise(function (resolve) {
+          bridge.fetchHostApiSchema(function (text) {
+            try {
+              schema = JSON.parse(text);
+              writeCachedSchema(schemaHash, text);
+            } catch (e) {
+              logError("Failed to parse HostApi schema.");
+              schema = {};
+            }
+            resolve(schema);
+          });
+        });
+      }
+      return schemaRequest;
+    }
+
+    // Listeners are kept per event id, the position of the type in validEventTypes, which is
+    // what the host sends with each event.
+    var eventIds = {};
+    var listeners = validEventTypes.map(function (eventType, id) {
+      eventIds[eventType] = id;
+      return [];
+    });
 
-    function ensureEventType(eventType) {
-      if (validEventTypes.indexOf(eventType) === -1) {
+    function eventIdOf(eventType) {
+      var id = typeof eventType === "number" ? eventType : eventIds[eventType];
+      if (typeof id !== "number" || !listeners[id]) {
         throw new Error("eventType " + eventType + " not found.");
       }
+      return id;
     }
 
-    function addEventListener(eventType, callback) {
-      ensureEventType(eventType);
-      if (!listeners[eventType]) {
-        listeners[eventType] = [];
+    function reportSubscribers(id) {
+      if (typeof bridge.setEventSubscriberCount === "function") {
+        bridge.setEventSubscriberCount(id, listeners[id].length);
       }
-      listeners[eventType].push(callback);
+    }
+
+    function addEventListener(eventType, callback) {
+      var id = eventIdOf(eventType);
+      listeners[id].push(callback);
+      reportSubscribers(id);
     }
 
     function removeEventListener(eventType, callback) {
-      ensureEventType(eventType);
-      var list = listeners[eventType] || [];
-      var index = list.indexOf(callback);
+      var id = eventIdOf(eventType);
+      var index = listeners[id].indexOf(callback);
       if (index !== -1) {
-        list.splice(index, 1);
+        listeners[id].splice(index, 1);
+        reportSubscribers(id);
       }
     }
 
-    function dispatchEvent(eventType, payload) {
-      var list = listeners[eventType] || [];
+    function dispatchEvent(eventId, payload) {
+      var list = listeners[typeof eventId === "number" ? eventId : eventIds[eventId]];
+      if (!list) {
+        return;
+      }
       list.forEach(function (cb) {
         try {
           cb(payload);
@@ -530,6 +1763,19 @@ void WebHost::injectHostApiBootstrap() {
       });
     }
 
+    function dispatchEvents(events) {
+      for (var i = 0; i < events.length; i++) {
+        dispatchEvent(events[i][0], events[i][1]);
+      }
+    }
+
+    if (bridge.eventDispatched) {
+      bridge.eventDispatched.connect(dispatchEvent);
+    }
+    if (bridge.eventsDispatched) {
+      bridge.eventsDispatched.connect(dispatchEvents);
+    }
+
     bridge.inputProvided.connect(function (uuid, input) {
       if (pendingInputs[uuid]) {
         pendingInputs[uuid](input);
@@ -542,7 +1788,11 @@ void WebHost::injectHostApiBootstrap() {
     var api = {
       validEventTypes: validEventTypes,
       version: hostApiVersion,
-      schema: schema || {},
+      get schema() {
+        return schema;
+      },
+      schemaHash: schemaHash,
+      loadSchema: loadSchema,
       sendData: function (payload) {
         bridge.sendData(payload);
       },
@@ -562,58 +1812,494 @@ void WebHost::injectHostApiBootstrap() {
           });
         });
       },
+      fetchBlob: function (id) {
+        var url = String(id).indexOf("webhost:") === 0 ? String(id) : "webhost://blob/" + id;
+        return fetch(url).then(function (response) {
+          if (!response.ok) {
+            throw new Error("HostApi blob " + id + " is not available.");
+          }
+          return response.arrayBuffer();
+        });
+      },
+      upload: function (name, body, options) {
+        var opts = options || {};
+        return fetch(config.uploadUrl + "/" + encodeURIComponent(name), {
+          method: "POST",
+          body: body,
+          signal: opts.signal
+        }).then(function (response) {
+          if (!response.ok) {
+            throw new Error("HostApi upload " + name + " failed.");
+          }
+          return response.json();
+        });
+      },
+      openStream: function (id, options) {
+        var opts = options || {};
+        var streamUrl = "webhost://stream/" + encodeURIComponent(id);
+        // Each pull asks for at most desiredSize bytes, so a slow reader stops the host writer.
+        return new ReadableStream({
+          pull: function (controller) {
+            var credit = Math.max(1, Math.floor(controller.desiredSize || 0));
+            return fetch(streamUrl + "?credit=" + credit)
+              .then(function (response) {
+                if (!response.ok) {
+                  throw new Error("HostApi stream " + id + " is not available.");
+                }
+                return response.arrayBuffer();
+              })
+              .then(function (buffer) {
+                if (buffer.byteLength === 0) {
+                  controller.close();
+                  return;
+                }
+                controller.enqueue(new Uint8Array(buffer));
+              });
+          },
+          cancel: function () {
+            return fetch(streamUrl + "?cancel=1").then(function () {}, function () {});
+          }
+        }, new ByteLengthQueuingStrategy({ highWaterMark: opts.highWaterMark || 1048576 }));
+      },
       addEventListener: addEventListener,
       removeEventListener: removeEventListener,
       __dispatchEvent: dispatchEvent,
+      __dispatchEvents: dispatchEvents,
+      // handler(paths) receives the changed files the page has loaded, other than swapped
+      // stylesheets; returning true means it applied them and the page is not reloaded.
+      setHotReloadHandler: function (handler) {
+        hotReloadHandler = typeof handler === "function" ? handler : null;
+      },
+      __hotReload: hotReload,
       __ready: true
     };
 
-    var objects = (schema && schema.objects) ? schema.objects : [];
-    objects.forEach(function (objectInfo) {
-      if (!objectInfo || !objectInfo.name) {
-        return;
+    var rpc = createRpc(bridge);
+    // Calls a method by name, as wrappers without a method index do; lets benchmarks compare the
+    // two channel paths.
+    api.__callByName = function (objectName, methodName, args, options) {
+      return rpc(objectName, methodName, null, args, options);
+    };
+    var sharedObjects = {};
+    if (bridge.hostApiSignal) {
+      bridge.hostApiSignal.connect(function (objectName, signalName, argsJson) {
+        var raw = sharedObjects[objectName];
+        var handlers = raw && raw[signalName] ? raw[signalName].handlers : null;
+        if (!handlers || handlers.length === 0) {
+          return;
+        }
+        var args = JSON.parse(argsJson);
+        handlers.slice().forEach(function (handler) {
+          try {
+            handler.apply(null, args);
+          } catch (err) {
+            logError("HostApi " + objectName + "." + signalName + " handler failed: " + err);
+          }
+        });
+      });
+    }
+
+    // Stands in for the channel object of a shared HostApi object; hostApiSignal feeds it.
+    function sharedRawObject(signalNames) {
+      var raw = {};
+      signalNames.forEach(function (signalName) {
+        var handlers = [];
+        raw[signalName] = {
+          handlers: handlers,
+          connect: function (handler) {
+            handlers.push(handler);
+          },
+          disconnect: function (handler) {
+            var index = handlers.indexOf(handler);
+            if (index !== -1) {
+              handlers.splice(index, 1);
+            }
+          }
+        };
+      });
+      return raw;
+    }
+
+    function loadRawObject(name, wrapper) {
+      if (wrapper.d) {
+        return function (done) {
+          bridge.attachHostApiObject(name, function (attached) {
+            var raw = attached ? sharedRawObject(wrapper.n) : null;
+            sharedObjects[name] = raw;
+            done(raw);
+          });
+        };
       }
-      var channelName = "HostApi_" + objectInfo.name;
-      var rawObject = channel.objects[channelName];
-      if (!rawObject) {
-        logError("HostApi object missing: " + channelName);
+      return function (done) {
+        bridge.hostApiObject(name, done);
+      };
+    }
+
+    Object.keys(hostApiWrappers).forEach(function (name) {
+      var wrapper = hostApiWrappers[name];
+      var rawObject = channel.objects["HostApi_" + name];
+      if (rawObject) {
+        api[name] = wrapObject(rawObject, name, wrapper, rpc);
         return;
       }
-      api[objectInfo.name] = wrapObject(rawObject, objectInfo);
+      // Not constructed yet, or shared: the first access asks the host for the object.
+      Object.defineProperty(api, name, {
+        configurable: true,
+        enumerable: true,
+        get: function () {
+          var wrapped = wrapObject(null, name, wrapper, rpc, loadRawObject(name, wrapper));
+          Object.defineProperty(api, name, { value: wrapped, enumerable: true });
+          return wrapped;
+        }
+      });
     });
 
     return api;
   }
 
-  function init() {
-    if (typeof qt === "undefined" || !qt.webChannelTransport) {
-      logError("Qt WebChannel bridge not available.");
-      return;
+  // Minimal CBOR codec for the binary channel transport. It covers what QCborValue produces for
+  // JSON-compatible values: integers, floats, strings, byte strings, arrays, maps, simple values
+  // and tags (which are skipped).
+  var textEncoder = typeof TextEncoder !== "undefined" ? new TextEncoder() : null;
+  var textDecoder = typeof TextDecoder !== "undefined" ? new TextDecoder() : null;
+
+  function cborEncode(value) {
+    var buffer = new Uint8Array(256);
+    var view = new DataView(buffer.buffer);
+    var offset = 0;
+
+    function reserve(size) {
+      if (offset + size <= buffer.length) {
+        return;
+      }
+      var capacity = buffer.length * 2;
+      while (capacity < offset + size) {
+        capacity *= 2;
+      }
+      var grown = new Uint8Array(capacity);
+      grown.set(buffer.subarray(0, offset));
+      buffer = grown;
+      view = new DataView(buffer.buffer);
+    }
+
+    function writeHead(major, length) {
+      reserve(9);
+      if (length < 24) {
+        buffer[offset++] = (major << 5) | length;
+      } else if (length < 0x100) {
+        buffer[offset++] = (major << 5) | 24;
+        buffer[offset++] = length;
+      } else if (length < 0x10000) {
+        buffer[offset++] = (major << 5) | 25;
+        view.setUint16(offset, length);
+        offset += 2;
+      } else if (length < 0x100000000) {
+        buffer[offset++] = (major << 5) | 26;
+        view.setUint32(offset, length);
+        offset += 4;
+      } else {
+        buffer[offset++] = (major << 5) | 27;
+        view.setUint32(offset, Math.floor(length / 0x100000000));
+        view.setUint32(offset + 4, length % 0x100000000);
+        offset += 8;
+      }
+    }
+
+    function writeBytes(bytes) {
+      writeHead(2, bytes.length);
+      reserve(bytes.length);
+      buffer.set(bytes, offset);
+      offset += bytes.length;
+    }
+
+    function writeString(text) {
+      if (!textEncoder) {
+        writeBytes(new Uint8Array(0));
+        return;
+      }
+      // UTF-8 needs at most three bytes per UTF-16 code unit.
+      var maxLength = text.length * 3;
+      var headSize = maxLength < 24 ? 1 : maxLength < 0x100 ? 2 : maxLength < 0x10000 ? 3 : 5;
+      // writeHead reserves nine bytes of its own, so reserve for that rather than headSize.
+      reserve(9 + maxLength);
+      var start = offset;
+      var written = textEncoder.encodeInto(text, buffer.subarray(start + headSize)).written;
+      var headOffset = offset;
+      writeHead(3, written);
+      var actualHeadSize = offset - headOffset;
+      if (actualHeadSize !== headSize) {
+        buffer.copyWithin(start + actualHeadSize, start + headSize, start + headSize + written);
+      }
+      offset = start + actualHeadSize + written;
+    }
+
+    function write(item) {
+      if (item === null || item === undefined) {
+        reserve(1);
+        buffer[offset++] = 0xf6;
+      } else if (item === false || item === true) {
+        reserve(1);
+        buffer[offset++] = item ? 0xf5 : 0xf4;
+      } else if (typeof item === "number") {
+        if (Number.isSafeInteger(item)) {
+          if (item >= 0) {
+            writeHead(0, item);
+          } else {
+            writeHead(1, -1 - item);
+          }
+        } else {
+          reserve(9);
+          buffer[offset++] = 0xfb;
+          view.setFloat64(offset, item);
+          offset += 8;
+        }
+      } else if (typeof item === "string") {
+        writeString(item);
+      } else if (item instanceof ArrayBuffer) {
+        writeBytes(new Uint8Array(item));
+      } else if (ArrayBuffer.isView(item)) {
+        writeBytes(new Uint8Array(item.buffer, item.byteOffset, item.byteLength));
+      } else if (Array.isArray(item)) {
+        writeHead(4, item.length);
+        for (var i = 0; i < item.length; i++) {
+          write(item[i]);
+        }
+      } else if (typeof item.toJSON === "function") {
+        write(item.toJSON());
+      } else {
+        var keys = Object.keys(item).filter(function (key) {
+          return item[key] !== undefined && typeof item[key] !== "function";
+        });
+        writeHead(5, keys.length);
+        keys.forEach(function (key) {
+          writeString(key);
+          write(item[key]);
+        });
+      }
+    }
+
+    write(value);
+    return buffer.subarray(0, offset);
+  }
+
+  function cborDecode(bytes) {
+    var view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+    var offset = 0;
+
+    function readLength(info) {
+      var value;
+      if (info < 24) {
+        return info;
+      }
+      if (info === 24) {
+        value = view.getUint8(offset);
+        offset += 1;
+      } else if (info === 25) {
+        value = view.getUint16(offset);
+        offset += 2;
+      } else if (info === 26) {
+        value = view.getUint32(offset);
+        offset += 4;
+      } else if (info === 27) {
+        value = view.getUint32(offset) * 0x100000000 + view.getUint32(offset + 4);
+        offset += 8;
+      } else {
+        throw new Error("Unsupported CBOR length encoding " + info + ".");
+      }
+      return value;
+    }
+
+    function readHalf() {
+      var half = view.getUint16(offset);
+      offset += 2;
+      var exponent = (half >> 10) & 0x1f;
+      var mantissa = half & 0x3ff;
+      var value;
+      if (exponent === 0) {
+        value = mantissa * Math.pow(2, -24);
+      } else if (exponent === 31) {
+        value = mantissa ? NaN : Infinity;
+      } else {
+        value = (mantissa + 1024) * Math.pow(2, exponent - 25);
+      }
+      return half & 0x8000 ? -value : value;
     }
-    new QWebChannel(qt.webChannelTransport, function (channel) {
-      var bridge = channel.objects.HostBridge;
-      if (!bridge) {
-        logError("HostBridge not available.");
+
+    function read() {
+      var initial = view.getUint8(offset++);
+      var major = initial >> 5;
+      var info = initial & 0x1f;
+      var length;
+      var result;
+      var i;
+
+      switch (major) {
+        case 0:
+          return readLength(info);
+        case 1:
+          return -1 - readLength(info);
+        case 2:
+          length = readLength(info);
+          result = bytes.slice(offset, offset + length).buffer;
+          offset += length;
+          return result;
+        case 3:
+          length = readLength(info);
+          result = textDecoder.decode(bytes.subarray(offset, offset + length));
+          offset += length;
+          return result;
+        case 4:
+          length = readLength(info);
+          result = new Array(length);
+          for (i = 0; i < length; i++) {
+            result[i] = read();
+          }
+          return result;
+        case 5:
+          length = readLength(info);
+          result = {};
+          for (i = 0; i < length; i++) {
+            var key = read();
+            result[key] = read();
+          }
+          return result;
+        case 6:
+          readLength(info);
+          return read();
+        default:
+          if (info === 20) {
+            return false;
+          }
+          if (info === 21) {
+            return true;
+          }
+          if (info === 22) {
+            return null;
+          }
+          if (info === 23) {
+            return undefined;
+          }
+          if (info === 25) {
+            return readHalf();
+          }
+          if (info === 26) {
+            result = view.getFloat32(offset);
+            offset += 4;
+            return result;
+          }
+          if (info === 27) {
+            result = view.getFloat64(offset);
+            offset += 8;
+            return result;
+          }
+          throw new Error("Unsupported CBOR simple value " + info + ".");
+      }
+    }
+
+    return read();
+  }
+
+  // QWebChannel transport over webhost://channel/<token>. Outgoing messages are batched per
+  // microtask and POSTed in order; incoming messages arrive through a long poll on /recv.
+  function createCborTransport(channelUrl) {
+    var transport = { onmessage: null };
+    var outbox = [];
+    var scheduled = false;
+    var sending = false;
+
+    function flush() {
+      scheduled = false;
+      if (sending || outbox.length === 0) {
         return;
       }
-      var schema = safeParseSchema(bridge.hostApiSchema);
-      var hostApi = buildHostApi(bridge, schema, channel);
-      window.HostApi = hostApi;
+      var batch = outbox;
+      outbox = [];
+      sending = true;
+      fetch(channelUrl + "/send", { method: "POST", body: cborEncode(batch) })
+        .catch(function (err) {
+          logError("HostApi channel send failed: " + err);
+        })
+        .then(function () {
+          sending = false;
+          flush();
+        });
+    }
 
-      var expected = window.HostApiExpectedVersion || window.__HOSTAPI_EXPECTED_VERSION;
-      if (expected && !isCompatible(expected, hostApi.version)) {
-        logError("HostApi version mismatch. expected=" + expected + " actual=" + hostApi.version);
-        dispatchCustomEvent("HostApiVersionMismatch", {
-          expected: expected,
-          actual: hostApi.version
+    function poll() {
+      fetch(channelUrl + "/recv")
+        .then(function (response) {
+          return response.arrayBuffer();
+        })
+        .then(function (body) {
+          var messages = body.byteLength ? cborDecode(new Uint8Array(body)) : [];
+          for (var i = 0; i < messages.length; i++) {
+            if (transport.onmessage) {
+              transport.onmessage({ data: messages[i] });
+            }
+          }
+          poll();
+        }, function (err) {
+          logError("HostApi channel receive failed: " + err);
+          setTimeout(poll, 1000);
         });
+    }
+
+    transport.send = function (data) {
+      // QWebChannel stringifies the init message before its send() can be replaced.
+      outbox.push(typeof data === "string" ? JSON.parse(data) : data);
+      if (!scheduled) {
+        scheduled = true;
+        Promise.resolve().then(flush);
       }
+    };
 
-      dispatchCustomEvent("HostApiReady", {
-        version: hostApi.version,
-        schema: schema
+    poll();
+    return transport;
+  }
+
+  function onChannel(channel) {
+    var bridge = channel.objects.HostBridge;
+    if (!bridge) {
+      logError("HostBridge not available.");
+      return;
+    }
+    var hostApi = buildHostApi(bridge, channel);
+    window.HostApi = hostApi;
+
+    var expected = window.HostApiExpectedVersion || window.__HOSTAPI_EXPECTED_VERSION;
+    if (expected && !isCompatible(expected, hostApi.version)) {
+      logError("HostApi version mismatch. expected=" + expected + " actual=" + hostApi.version);
+      dispatchCustomEvent("HostApiVersionMismatch", {
+        expected: expected,
+        actual: hostApi.version
       });
+    }
+
+    dispatchCustomEvent("HostApiReady", {
+      version: hostApi.version,
+      schema: hostApi.schema,
+      schemaHash: hostApi.schemaHash
     });
+    if (bridge.notifyHostApiReady) {
+      bridge.notifyHostApiReady(hostApi.version);
+    }
+  }
+
+  function init() {
+    if (config.transport === "cbor") {
+      var transport = createCborTransport(config.channelUrl);
+      var webChannel = new QWebChannel(transport, onChannel);
+      // Hand message objects to the transport as-is instead of as JSON text.
+      webChannel.send = function (data) {
+        transport.send(data);
+      };
+      return;
+    }
+    if (typeof qt === "undefined" || !qt.webChannelTransport) {
+      logError("Qt WebChannel bridge not available.");
+      return;
+    }
+    new QWebChannel(qt.webChannelTransport, onChannel);
   }
 
   function ensureWebChannel(ready) {
@@ -633,10 +2319,10 @@ void WebHost::injectHostApiBootstrap() {
   }
 
   ensureWebChannel(init);
-})();
+})(__WEBHOST_CONFIG__, __WEBHOST_WRAPPERS__);
 )JS");
-
-  m_page->runJavaScript(script);
+  return script.replace(QStringLiteral("__WEBHOST_WRAPPERS__"), hostApiWrapperScript())
+      .replace(QStringLiteral("__WEBHOST_CONFIG__"), jsonValueToJs(config));
 }
 
 #include "WebHost.moc"
@@ -0,0 +1,74 @@
+#include "WebHostBlobRegistry.h"
+
+#include <QIODevice>
+#include <QUuid>
+#include <QWebEngineUrlRequestJob>
+
+#include "WebHostSchemeHandler.h"
+
+WebHostBlobRegistry::WebHostBlobRegistry(QObject *parent) : QObject(parent) {}
+
+QString WebHostBlobRegistry::publish(const QByteArray &data, const QByteArray &mimeType,
+                                     bool releaseAfterRead) {
+  const QString id = QUuid::createUuid().toString(QUuid::Id128);
+  m_blobs.insert(id, {data, nullptr, false, mimeType, releaseAfterRead});
+  return id;
+}
+
+QString WebHostBlobRegistry::publish(QIODevice *device, const QByteArray &mimeType) {
+  if (!device) {
+    return QString();
+  }
+  const QString id = QUuid::createUuid().toString(QUuid::Id128);
+  device->setParent(this);
+  m_blobs.insert(id, {QByteArray(), device, true, mimeType, true});
+  return id;
+}
+
+bool WebHostBlobRegistry::release(const QString &id) {
+  const auto it = m_blobs.constFind(id);
+  if (it == m_blobs.cend()) {
+    return false;
+  }
+  if (it->device) {
+    it->device->deleteLater();
+  }
+  m_blobs.erase(it);
+  emit released(id);
+  return true;
+}
+
+bool WebHostBlobRegistry::contains(const QString &id) const {
+  return m_blobs.contains(id);
+}
+
+bool WebHostBlobRegistry::handleRequest(QWebEngineUrlRequestJob *job, const QString &path) {
+  const auto it = m_blobs.find(path);
+  if (it == m_blobs.end()) {
+    return false;
+  }
+
+  WebHostSchemeHandler::allowCrossOrigin(job);
+  if (it->fromDevice) {
+    // The job reads the device asynchronously, so it takes over ownership.
+    QIODevice *device = it->device;
+    if (device) {
+      device->setParent(job);
+    }
+    if (!device || (!device->isOpen() && !device->open(QIODevice::ReadOnly))) {
+      job->fail(QWebEngineUrlRequestJob::RequestFailed);
+    } else {
+      job->reply(it->mimeType, device);
+    }
+    m_blobs.erase(it);
+    emit released(path);
+    return true;
+  }
+
+  WebHostSchemeHandler::replyWithData(job, it->mimeType, it->data);
+  if (it->releaseAfterRead) {
+    m_blobs.erase(it);
+    emit released(path);
+  }
+  return true;
+}
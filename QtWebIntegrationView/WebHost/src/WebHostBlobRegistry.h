@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+class QIODevice;
+class QWebEngineUrlRequestJob;
+
+// Binary payloads published by a WebHost and served at webhost://blob/<id>. QByteArray blobs are
+// handed to the request without copying; QIODevice blobs are streamed by WebEngine and owned by
+// the registry until they are served or released.
+class WebHostBlobRegistry : public QObject {
+  Q_OBJECT
+
+public:
+  explicit WebHostBlobRegistry(QObject *parent = nullptr);
+
+  QString publish(const QByteArray &data, const QByteArray &mimeType, bool releaseAfterRead);
+  QString publish(QIODevice *device, const QByteArray &mimeType);
+  bool release(const QString &id);
+  bool contains(const QString &id) const;
+
+  // Route handler for webhost://blob/<id>; returns false for ids published elsewhere.
+  bool handleRequest(QWebEngineUrlRequestJob *job, const QString &path);
+
+signals:
+  void released(QString id);
+
+private:
+  struct Blob {
+    QByteArray data;
+    QPointer<QIODevice> device;
+    bool fromDevice = false;
+    QByteArray mimeType;
+    bool releaseAfterRead = true;
+  };
+
+  QHash<QString, Blob> m_blobs;
+};
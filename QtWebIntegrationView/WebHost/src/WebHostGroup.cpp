@@ -0,0 +1,149 @@
+#include "WebHost/WebHostGroup.h"
+
+#include <QDebug>
+#include <QEvent>
+
+#include <utility>
+
+#include "WebHost/WebHost.h"
+
+WebHostGroup::WebHostGroup(QObject *parent) : QObject(parent) {}
+
+void WebHostGroup::addHost(WebHost *host, const QStringList &eventTypes) {
+  if (!host || contains(host)) {
+    return;
+  }
+  Member member;
+  member.host = host;
+  member.eventTypes = QSet<QString>(eventTypes.cbegin(), eventTypes.cend());
+  m_members.append(member);
+  host->installEventFilter(this);
+  connect(host, &QObject::destroyed, this, [this](QObject *object) {
+    m_members.removeIf([object](const Member &entry) { return !entry.host || entry.host == object; });
+  });
+}
+
+void WebHostGroup::removeHost(WebHost *host) {
+  if (!contains(host)) {
+    return;
+  }
+  host->removeEventFilter(this);
+  disconnect(host, nullptr, this, nullptr);
+  m_members.removeIf([host](const Member &member) { return member.host == host; });
+}
+
+bool WebHostGroup::contains(WebHost *host) const {
+  return findMember(host) != nullptr;
+}
+
+QList<WebHost *> WebHostGroup::hosts() const {
+  QList<WebHost *> hosts;
+  for (const auto &member : m_members) {
+    if (member.host) {
+      hosts.append(member.host);
+    }
+  }
+  return hosts;
+}
+
+void WebHostGroup::setEventFilter(WebHost *host, const QStringList &eventTypes) {
+  if (Member *member = findMember(host)) {
+    member->eventTypes = QSet<QString>(eventTypes.cbegin(), eventTypes.cend());
+  }
+}
+
+void WebHostGroup::setHiddenPolicy(HiddenPolicy policy) {
+  m_hiddenPolicy = policy;
+  if (policy == HiddenPolicy::Defer) {
+    return;
+  }
+  for (auto &member : m_members) {
+    if (policy == HiddenPolicy::Skip) {
+      member.deferred.clear();
+    } else {
+      flushDeferred(&member);
+    }
+  }
+}
+
+WebHostGroup::HiddenPolicy WebHostGroup::hiddenPolicy() const {
+  return m_hiddenPolicy;
+}
+
+int WebHostGroup::deferredEventCount(WebHost *host) const {
+  const Member *member = findMember(host);
+  return member ? int(member->deferred.size()) : 0;
+}
+
+void WebHostGroup::slotTriggerEvent(QString eventType, QJsonValue payload) {
+  if (hostApiEventId(eventType) < 0) {
+    qWarning() << "WebHostGroup ignoring unknown event type:" << eventType;
+    return;
+  }
+  if (payload.isUndefined()) {
+    payload = QJsonValue::Null;
+  }
+
+  // Script hosts share the dispatch source built by the first of them.
+  WebHost::PreparedEvent prepared{eventType, hostApiEventId(eventType), payload, {}};
+  for (auto &member : m_members) {
+    WebHost *host = member.host;
+    if (!host || (!member.eventTypes.isEmpty() && !member.eventTypes.contains(eventType))) {
+      continue;
+    }
+    if (!host->isVisible() && m_hiddenPolicy != HiddenPolicy::Deliver) {
+      if (m_hiddenPolicy == HiddenPolicy::Defer) {
+        member.deferred.removeIf(
+            [&eventType](const QPair<QString, QJsonValue> &entry) { return entry.first == eventType; });
+        member.deferred.append({eventType, payload});
+      }
+      continue;
+    }
+    // A host that is still loading queues the event itself.
+    if (host->isHostApiReady() && !host->wantsEvent(eventType)) {
+      continue;
+    }
+    host->deliverPreparedEvent(&prepared);
+  }
+}
+
+void WebHostGroup::triggerEvent(HostApiEvent event, const QJsonValue &payload) {
+  slotTriggerEvent(hostApiEventName(event), payload);
+}
+
+bool WebHostGroup::eventFilter(QObject *watched, QEvent *event) {
+  if (event->type() == QEvent::Show) {
+    if (Member *member = findMember(watched)) {
+      flushDeferred(member);
+    }
+  }
+  return QObject::eventFilter(watched, event);
+}
+
+WebHostGroup::Member *WebHostGroup::findMember(const QObject *host) {
+  for (auto &member : m_members) {
+    if (host && member.host == host) {
+      return &member;
+    }
+  }
+  return nullptr;
+}
+
+const WebHostGroup::Member *WebHostGroup::findMember(const QObject *host) const {
+  for (const auto &member : m_members) {
+    if (host && member.host == host) {
+      return &member;
+    }
+  }
+  return nullptr;
+}
+
+void WebHostGroup::flushDeferred(Member *member) {
+  const QList<QPair<QString, QJsonValue>> deferred = std::exchange(member->deferred, {});
+  if (!member->host) {
+    return;
+  }
+  for (const auto &entry : deferred) {
+    member->host->slotTriggerEvent(entry.first, entry.second);
+  }
+}
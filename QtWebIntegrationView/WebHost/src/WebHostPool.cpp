@@ -0,0 +1,169 @@
+#include "WebHost/WebHostPool.h"
+
+#include <QDebug>
+#include <QTimer>
+
+#include "WebHost/WebHost.h"
+
+namespace {
+
+constexpr int kRetryBaseMs = 250;
+constexpr int kRetryMaxMs = 30000;
+
+} // namespace
+
+WebHostPool::WebHostPool(QObject *parent)
+    : WebHostPool([]() { return new WebHost; }, parent) {}
+
+WebHostPool::WebHostPool(Factory factory, QObject *parent)
+    : QObject(parent), m_factory(std::move(factory)) {
+  m_idleTimer = new QTimer(this);
+  m_idleTimer->setSingleShot(true);
+  connect(m_idleTimer, &QTimer::timeout, this, &WebHostPool::evictIdle);
+  m_sinceAcquire.start();
+  scheduleRefill();
+}
+
+WebHostPool::~WebHostPool() {
+  for (const auto &host : std::as_const(m_warming)) {
+    delete host.data();
+  }
+  for (const auto &host : std::as_const(m_ready)) {
+    delete host.data();
+  }
+}
+
+void WebHostPool::setSize(int size) {
+  m_size = qMax(0, size);
+  while (m_ready.size() > m_size) {
+    delete m_ready.takeLast().data();
+  }
+  scheduleRefill();
+}
+
+int WebHostPool::size() const {
+  return m_size;
+}
+
+void WebHostPool::setIdleTimeout(int timeoutMs) {
+  m_idleTimeoutMs = qMax(0, timeoutMs);
+  if (m_idleTimeoutMs > 0) {
+    m_idleTimer->start(qMax<qint64>(0, m_idleTimeoutMs - m_sinceAcquire.elapsed()));
+  } else {
+    m_idleTimer->stop();
+  }
+}
+
+int WebHostPool::idleTimeout() const {
+  return m_idleTimeoutMs;
+}
+
+void WebHostPool::setWarmupTimeout(int timeoutMs) {
+  m_warmupTimeoutMs = qMax(0, timeoutMs);
+}
+
+int WebHostPool::warmupTimeout() const {
+  return m_warmupTimeoutMs;
+}
+
+int WebHostPool::readyCount() const {
+  return int(m_ready.size());
+}
+
+int WebHostPool::warmingCount() const {
+  return int(m_warming.size());
+}
+
+WebHost *WebHostPool::acquire(QWidget *parent) {
+  m_sinceAcquire.restart();
+  m_evicted = false;
+  if (m_idleTimeoutMs > 0) {
+    m_idleTimer->start(m_idleTimeoutMs);
+  }
+
+  WebHost *host = nullptr;
+  while (!host && !m_ready.isEmpty()) {
+    host = m_ready.takeFirst();
+  }
+  if (!host) {
+    host = m_factory();
+  }
+  disconnect(host, nullptr, this, nullptr);
+  host->setParent(parent);
+  scheduleRefill();
+  return host;
+}
+
+void WebHostPool::slotRefill() {
+  m_refillScheduled = false;
+  m_warming.removeAll(nullptr);
+  m_ready.removeAll(nullptr);
+  if (m_evicted || m_ready.size() + m_warming.size() >= m_size) {
+    return;
+  }
+
+  WebHost *host = m_factory();
+  m_warming.append(host);
+  connect(host, &WebHost::signalHostApiReady, this, [this, host]() { hostReady(host); });
+  connect(host, &WebHost::signalLoadFinished, this, [this, host](bool ok) {
+    if (!ok) {
+      hostFailed(host, "load failed");
+    }
+  });
+  if (m_warmupTimeoutMs > 0) {
+    // The pool is the context: an acquired host outlives it, and the timer must not.
+    QTimer::singleShot(m_warmupTimeoutMs, this, [this, guard = QPointer<WebHost>(host)]() {
+      if (guard) {
+        hostFailed(guard, "warm-up timed out");
+      }
+    });
+  }
+
+  // Spread construction over several event loop passes so a refill never blocks for long.
+  scheduleRefill();
+}
+
+void WebHostPool::scheduleRefill() {
+  if (m_refillScheduled) {
+    return;
+  }
+  m_refillScheduled = true;
+  const int delayMs =
+      m_failures > 0 ? qMin(kRetryMaxMs, kRetryBaseMs << qMin(m_failures - 1, 7)) : 0;
+  QTimer::singleShot(delayMs, this, &WebHostPool::slotRefill);
+}
+
+void WebHostPool::hostReady(WebHost *host) {
+  if (!m_warming.removeOne(host)) {
+    return;
+  }
+  disconnect(host, nullptr, this, nullptr);
+  m_failures = 0;
+  m_ready.append(host);
+  emit signalHostReady();
+}
+
+void WebHostPool::hostFailed(WebHost *host, const char *reason) {
+  if (!m_warming.removeOne(host)) {
+    return;
+  }
+  disconnect(host, nullptr, this, nullptr);
+  // Called from the host's own signal or timer.
+  host->deleteLater();
+  ++m_failures;
+  qWarning() << "WebHostPool discarded a host:" << reason << "- attempt" << m_failures;
+  emit signalHostFailed();
+  scheduleRefill();
+}
+
+void WebHostPool::evictIdle() {
+  m_evicted = true;
+  for (const auto &host : std::as_const(m_warming)) {
+    delete host.data();
+  }
+  for (const auto &host : std::as_const(m_ready)) {
+    delete host.data();
+  }
+  m_warming.clear();
+  m_ready.clear();
+}
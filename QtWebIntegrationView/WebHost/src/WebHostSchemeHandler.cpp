@@ -0,0 +1,87 @@
+#include "WebHostSchemeHandler.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QMultiMap>
+#include <QUrl>
+#include <QWebEngineUrlRequestJob>
+
+namespace {
+
+// Path syntax keeps "//name/rest" in the path, but QUrl reads "name" as the host, so both the
+// webhost://name/rest and webhost:/name/rest spellings are accepted.
+QString routePath(const QUrl &url) {
+  QString path = url.host().isEmpty() ? url.path() : QLatin1Char('/') + url.host() + url.path();
+  while (path.startsWith(QLatin1Char('/'))) {
+    path.remove(0, 1);
+  }
+  return path;
+}
+
+} // namespace
+
+WebHostSchemeHandler::WebHostSchemeHandler(QObject *parent) : QWebEngineUrlSchemeHandler(parent) {}
+
+QByteArray WebHostSchemeHandler::schemeName() {
+  return QByteArrayLiteral("webhost");
+}
+
+void WebHostSchemeHandler::addRoute(const QString &name, QObject *owner, Route route) {
+  m_routes[name].append({owner, std::move(route)});
+  if (owner) {
+    connect(owner, &QObject::destroyed, this, [this, owner]() { removeRoutes(owner); });
+  }
+}
+
+void WebHostSchemeHandler::removeRoutes(QObject *owner) {
+  for (auto it = m_routes.begin(); it != m_routes.end();) {
+    it->removeIf([owner](const RouteEntry &entry) { return !entry.owner || entry.owner == owner; });
+    it = it->isEmpty() ? m_routes.erase(it) : std::next(it);
+  }
+}
+
+void WebHostSchemeHandler::requestStarted(QWebEngineUrlRequestJob *job) {
+  if (job->requestMethod() == "OPTIONS") {
+    // CORS preflight, e.g. for a POST whose body is a Blob with a non-simple content type.
+    QMultiMap<QByteArray, QByteArray> headers;
+    headers.insert(QByteArrayLiteral("Access-Control-Allow-Origin"), QByteArrayLiteral("*"));
+    headers.insert(QByteArrayLiteral("Access-Control-Allow-Methods"),
+                   QByteArrayLiteral("GET, POST"));
+    headers.insert(QByteArrayLiteral("Access-Control-Allow-Headers"), QByteArrayLiteral("*"));
+    job->setAdditionalResponseHeaders(headers);
+    replyWithData(job, QByteArrayLiteral("text/plain"), QByteArray());
+    return;
+  }
+
+  const QString path = routePath(job->requestUrl());
+  const int separator = path.indexOf(QLatin1Char('/'));
+  const QString name = separator < 0 ? path : path.left(separator);
+  const QString rest = separator < 0 ? QString() : path.mid(separator + 1);
+
+  // Copy: a route may add or remove routes while it runs.
+  const QList<RouteEntry> routes = m_routes.value(name);
+  for (const auto &entry : routes) {
+    if (entry.owner && entry.route(job, rest)) {
+      return;
+    }
+  }
+
+  qWarning() << "WebHost scheme request not handled:" << job->requestUrl();
+  job->fail(QWebEngineUrlRequestJob::UrlNotFound);
+}
+
+void WebHostSchemeHandler::replyWithData(QWebEngineUrlRequestJob *job,
+                                         const QByteArray &contentType, const QByteArray &data) {
+  auto *buffer = new QBuffer(job);
+  buffer->setData(data);
+  buffer->open(QIODevice::ReadOnly);
+  job->reply(contentType, buffer);
+}
+
+void WebHostSchemeHandler::allowCrossOrigin(QWebEngineUrlRequestJob *job) {
+  // Pages loaded from file:// or qrc:// have an opaque origin, so fetches into webhost:// are
+  // always cross-origin.
+  QMultiMap<QByteArray, QByteArray> headers;
+  headers.insert(QByteArrayLiteral("Access-Control-Allow-Origin"), QByteArrayLiteral("*"));
+  job->setAdditionalResponseHeaders(headers);
+}
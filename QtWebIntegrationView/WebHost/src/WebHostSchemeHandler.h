@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <QWebEngineUrlSchemeHandler>
+
+#include <functional>
+
+class QWebEngineUrlRequestJob;
+
+// Serves webhost:// requests. Features register a route under the first path segment (for
+// example "channel" for webhost://channel/...) and receive the rest of the path. A route returns
+// false when the request is not its own, so several WebHosts can share one handler.
+class WebHostSchemeHandler : public QWebEngineUrlSchemeHandler {
+  Q_OBJECT
+
+public:
+  using Route = std::function<bool(QWebEngineUrlRequestJob *job, const QString &path)>;
+
+  explicit WebHostSchemeHandler(QObject *parent = nullptr);
+
+  static QByteArray schemeName();
+
+  void addRoute(const QString &name, QObject *owner, Route route);
+  void removeRoutes(QObject *owner);
+
+  void requestStarted(QWebEngineUrlRequestJob *job) override;
+
+  // Replies with an in-memory body. The data is implicitly shared, not copied.
+  static void replyWithData(QWebEngineUrlRequestJob *job, const QByteArray &contentType,
+                            const QByteArray &data);
+  static void allowCrossOrigin(QWebEngineUrlRequestJob *job);
+
+private:
+  struct RouteEntry {
+    QPointer<QObject> owner;
+    Route route;
+  };
+
+  QHash<QString, QList<RouteEntry>> m_routes;
+};
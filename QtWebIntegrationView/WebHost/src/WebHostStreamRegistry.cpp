@@ -0,0 +1,151 @@
+#include "WebHostStreamRegistry.h"
+
+#include <QDebug>
+#include <QUrlQuery>
+#include <QUuid>
+#include <QWebEngineUrlRequestJob>
+
+#include <utility>
+
+#include "WebHostSchemeHandler.h"
+
+namespace {
+
+constexpr qint64 kDefaultPullCredit = 64 * 1024;
+
+} // namespace
+
+WebHostStreamRegistry::WebHostStreamRegistry(QObject *parent) : QObject(parent) {}
+
+QString WebHostStreamRegistry::open(qint64 highWaterMark) {
+  const QString id = QUuid::createUuid().toString(QUuid::Id128);
+  Stream stream;
+  stream.highWaterMark = qMax<qint64>(1, highWaterMark);
+  m_streams.insert(id, stream);
+  return id;
+}
+
+bool WebHostStreamRegistry::write(const QString &id, const QByteArray &data) {
+  auto it = m_streams.find(id);
+  if (it == m_streams.end() || it->closed) {
+    qWarning() << "WebHost write to a closed or unknown stream:" << id;
+    return false;
+  }
+
+  if (!data.isEmpty()) {
+    it->chunks.append(data);
+    it->queuedBytes += data.size();
+  }
+  servePull(id);
+
+  it = m_streams.find(id);
+  if (it == m_streams.end()) {
+    return false;
+  }
+  if (it->queuedBytes >= it->highWaterMark) {
+    it->blocked = true;
+    return false;
+  }
+  return true;
+}
+
+void WebHostStreamRegistry::close(const QString &id) {
+  const auto it = m_streams.find(id);
+  if (it == m_streams.end()) {
+    return;
+  }
+  it->closed = true;
+  servePull(id);
+}
+
+bool WebHostStreamRegistry::isWritable(const QString &id) const {
+  const auto it = m_streams.constFind(id);
+  return it != m_streams.cend() && !it->closed && it->queuedBytes < it->highWaterMark;
+}
+
+void WebHostStreamRegistry::cancelAll() {
+  const QHash<QString, Stream> streams = std::exchange(m_streams, {});
+  for (auto it = streams.cbegin(); it != streams.cend(); ++it) {
+    failPull(it.value());
+  }
+  for (auto it = streams.cbegin(); it != streams.cend(); ++it) {
+    emit cancelled(it.key());
+  }
+}
+
+bool WebHostStreamRegistry::handleRequest(QWebEngineUrlRequestJob *job, const QString &path) {
+  const auto it = m_streams.find(path);
+  if (it == m_streams.end()) {
+    return false;
+  }
+
+  WebHostSchemeHandler::allowCrossOrigin(job);
+  const QUrlQuery query(job->requestUrl());
+  if (query.hasQueryItem(QStringLiteral("cancel"))) {
+    const Stream stream = *it;
+    m_streams.erase(it);
+    failPull(stream);
+    WebHostSchemeHandler::replyWithData(job, QByteArrayLiteral("text/plain"), QByteArray());
+    emit cancelled(path);
+    return true;
+  }
+
+  if (it->pendingPull) {
+    // A ReadableStream never has two pulls in flight; treat a second one as a protocol error.
+    job->fail(QWebEngineUrlRequestJob::RequestDenied);
+    return true;
+  }
+
+  const qint64 credit = query.queryItemValue(QStringLiteral("credit")).toLongLong();
+  it->pendingPull = job;
+  it->pendingCredit = credit > 0 ? credit : kDefaultPullCredit;
+  servePull(path);
+  return true;
+}
+
+void WebHostStreamRegistry::failPull(const Stream &stream) {
+  // A pull parked while waiting for data would otherwise hang until Chromium drops the request.
+  if (stream.pendingPull) {
+    stream.pendingPull->fail(QWebEngineUrlRequestJob::RequestAborted);
+  }
+}
+
+void WebHostStreamRegistry::servePull(const QString &id) {
+  const auto it = m_streams.find(id);
+  if (it == m_streams.end() || !it->pendingPull) {
+    return;
+  }
+
+  QWebEngineUrlRequestJob *job = it->pendingPull;
+  if (it->chunks.isEmpty()) {
+    if (it->closed) {
+      // An empty body ends the stream on the page side.
+      m_streams.erase(it);
+      WebHostSchemeHandler::replyWithData(job, QByteArrayLiteral("application/octet-stream"),
+                                          QByteArray());
+    }
+    return;
+  }
+
+  // Send whole chunks while they fit the credit; a single chunk is shared rather than copied.
+  QByteArray body = it->chunks.takeFirst();
+  if (body.size() > it->pendingCredit) {
+    it->chunks.prepend(body.mid(it->pendingCredit));
+    body.truncate(it->pendingCredit);
+  }
+  while (!it->chunks.isEmpty() && body.size() + it->chunks.first().size() <= it->pendingCredit) {
+    body.append(it->chunks.takeFirst());
+  }
+  it->queuedBytes -= body.size();
+  it->pendingPull.clear();
+  it->pendingCredit = 0;
+
+  const bool resumed = it->blocked && it->queuedBytes < it->highWaterMark;
+  if (resumed) {
+    it->blocked = false;
+  }
+  WebHostSchemeHandler::replyWithData(job, QByteArrayLiteral("application/octet-stream"), body);
+  if (resumed) {
+    emit writable(id);
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+class QWebEngineUrlRequestJob;
+
+// Host-to-page byte streams served at webhost://stream/<id>. The page pulls with
+// ?credit=<bytes>, the number of bytes its ReadableStream can still queue, and the pull is held
+// until data is available. Writers see backpressure once more than highWaterMark bytes are waiting
+// for the page, and are told through writable() when the queue has drained below it again.
+class WebHostStreamRegistry : public QObject {
+  Q_OBJECT
+
+public:
+  explicit WebHostStreamRegistry(QObject *parent = nullptr);
+
+  QString open(qint64 highWaterMark);
+  bool write(const QString &id, const QByteArray &data);
+  void close(const QString &id);
+  bool isWritable(const QString &id) const;
+
+  // Drops every stream, e.g. when the page navigates away. A pull still waiting for data fails
+  // with RequestAborted, as it does when the page cancels its stream.
+  void cancelAll();
+
+  // Route handler for webhost://stream/<id>.
+  bool handleRequest(QWebEngineUrlRequestJob *job, const QString &path);
+
+signals:
+  void writable(QString id);
+  void cancelled(QString id);
+
+private:
+  struct Stream {
+    QList<QByteArray> chunks;
+    qint64 queuedBytes = 0;
+    qint64 highWaterMark = 0;
+    bool closed = false;
+    bool blocked = false;
+    QPointer<QWebEngineUrlRequestJob> pendingPull;
+    qint64 pendingCredit = 0;
+  };
+
+  void failPull(const Stream &stream);
+  void servePull(const QString &id);
+
+  QHash<QString, Stream> m_streams;
+};
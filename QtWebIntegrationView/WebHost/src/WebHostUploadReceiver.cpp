@@ -0,0 +1,167 @@
+#include "WebHostUploadReceiver.h"
+
+#include <QDebug>
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+#include <QUuid>
+#include <QWebEngineUrlRequestJob>
+
+#include <algorithm>
+#include <utility>
+
+#include "WebHostSchemeHandler.h"
+
+namespace {
+
+constexpr qint64 kUploadChunkSize = 512 * 1024;
+
+} // namespace
+
+WebHostUploadReceiver::WebHostUploadReceiver(QObject *parent)
+    : QObject(parent), m_token(QUuid::createUuid().toString(QUuid::Id128)) {
+  m_pumpTimer = new QTimer(this);
+  m_pumpTimer->setInterval(0);
+  connect(m_pumpTimer, &QTimer::timeout, this, &WebHostUploadReceiver::pump);
+}
+
+QString WebHostUploadReceiver::baseUrl() const {
+  return QStringLiteral("webhost://upload/") + m_token;
+}
+
+void WebHostUploadReceiver::setSink(const QString &name, QIODevice *device) {
+  if (device) {
+    m_sinks.insert(name, device);
+  } else {
+    m_sinks.remove(name);
+  }
+}
+
+bool WebHostUploadReceiver::handleRequest(QWebEngineUrlRequestJob *job, const QString &route) {
+  const int separator = route.indexOf(QLatin1Char('/'));
+  if (separator < 0 || route.left(separator) != m_token) {
+    return false;
+  }
+
+  const QString path = route.mid(separator + 1);
+  WebHostSchemeHandler::allowCrossOrigin(job);
+  if (job->requestMethod() != "POST" || path.isEmpty()) {
+    job->fail(QWebEngineUrlRequestJob::RequestDenied);
+    return true;
+  }
+  QIODevice *body = job->requestBody();
+  if (!body) {
+    job->fail(QWebEngineUrlRequestJob::RequestFailed);
+    return true;
+  }
+
+  Upload upload;
+  upload.id = QUuid::createUuid().toString(QUuid::Id128);
+  upload.name = path;
+  upload.job = job;
+  upload.sink = m_sinks.value(path);
+  upload.hasSink = !upload.sink.isNull();
+  m_uploads.append(upload);
+  const QString id = upload.id;
+  connect(body, &QIODevice::readyRead, this, [this, id]() { resume(id, false); });
+  connect(body, &QIODevice::readChannelFinished, this, [this, id]() { resume(id, true); });
+  emit started(upload.id, upload.name);
+
+  if (!m_pumpTimer->isActive()) {
+    m_pumpTimer->start();
+  }
+  return true;
+}
+
+void WebHostUploadReceiver::pump() {
+  if (m_buffer.size() != kUploadChunkSize) {
+    m_buffer.resize(kUploadChunkSize);
+  }
+
+  // Iterate over a snapshot: finishing an upload or a connected slot may change m_uploads.
+  const QList<Upload> uploads = std::exchange(m_uploads, {});
+  QList<Upload> remaining;
+  for (Upload upload : uploads) {
+    if (upload.waiting) {
+      remaining.append(upload);
+      continue;
+    }
+    QIODevice *body = upload.job ? upload.job->requestBody() : nullptr;
+    if (!body) {
+      // The page cancelled the request.
+      finish(upload, false);
+      continue;
+    }
+    if (upload.hasSink && !upload.sink) {
+      qWarning() << "WebHost upload sink destroyed during" << upload.name;
+      finish(upload, false);
+      continue;
+    }
+
+    const qint64 read = body->read(m_buffer.data(), kUploadChunkSize);
+    if (read < 0) {
+      finish(upload, false);
+      continue;
+    }
+    if (read == 0) {
+      // A sequential body reports atEnd whenever nothing is buffered yet, so only its
+      // readChannelFinished marks the end.
+      if (upload.bodyFinished || (!body->isSequential() && body->atEnd())) {
+        finish(upload, true);
+      } else {
+        upload.waiting = true;
+        remaining.append(upload);
+      }
+      continue;
+    }
+
+    upload.size += read;
+    if (upload.hasSink) {
+      if (upload.sink->write(m_buffer.constData(), read) != read) {
+        qWarning() << "WebHost upload sink write failed for" << upload.name << ":"
+                   << upload.sink->errorString();
+        finish(upload, false);
+        continue;
+      }
+    } else {
+      emit chunkReceived(upload.id, QByteArray(m_buffer.constData(), read));
+    }
+    remaining.append(upload);
+  }
+
+  m_uploads = remaining + m_uploads;
+  const bool active = std::any_of(m_uploads.cbegin(), m_uploads.cend(),
+                                  [](const Upload &upload) { return !upload.waiting; });
+  if (!active) {
+    m_pumpTimer->stop();
+  }
+}
+
+void WebHostUploadReceiver::resume(const QString &uploadId, bool bodyFinished) {
+  for (Upload &upload : m_uploads) {
+    if (upload.id == uploadId) {
+      upload.waiting = false;
+      upload.bodyFinished = upload.bodyFinished || bodyFinished;
+      if (!m_pumpTimer->isActive()) {
+        m_pumpTimer->start();
+      }
+      return;
+    }
+  }
+}
+
+void WebHostUploadReceiver::finish(const Upload &upload, bool ok) {
+  if (upload.job) {
+    if (ok) {
+      QJsonObject result;
+      result.insert(QStringLiteral("id"), upload.id);
+      result.insert(QStringLiteral("size"), upload.size);
+      WebHostSchemeHandler::replyWithData(upload.job, QByteArrayLiteral("application/json"),
+                                          QJsonDocument(result).toJson(QJsonDocument::Compact));
+    } else {
+      upload.job->fail(QWebEngineUrlRequestJob::RequestFailed);
+    }
+  }
+  emit finished(upload.id, upload.name, upload.size, ok);
+}
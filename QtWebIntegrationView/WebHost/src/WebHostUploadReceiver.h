@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+class QIODevice;
+class QTimer;
+class QWebEngineUrlRequestJob;
+
+// Receives POST bodies sent to webhost://upload/<token>/<name>. Bodies are read in fixed-size chunks, one
+// chunk per upload per event-loop pass, and either written to the sink registered for the name or
+// emitted through chunkReceived, so an upload is never held in memory as a whole.
+class WebHostUploadReceiver : public QObject {
+  Q_OBJECT
+
+public:
+  explicit WebHostUploadReceiver(QObject *parent = nullptr);
+
+  QString baseUrl() const;
+
+  void setSink(const QString &name, QIODevice *device);
+
+  // Route handler for webhost://upload/...; returns false for other tokens.
+  bool handleRequest(QWebEngineUrlRequestJob *job, const QString &path);
+
+signals:
+  void started(QString uploadId, QString name);
+  void chunkReceived(QString uploadId, QByteArray chunk);
+  void finished(QString uploadId, QString name, qint64 size, bool ok);
+
+private:
+  struct Upload {
+    QString id;
+    QString name;
+    QPointer<QWebEngineUrlRequestJob> job;
+    QPointer<QIODevice> sink;
+    // A sink was registered when the upload started; losing it fails the upload.
+    bool hasSink = false;
+    // The body had no data; pump skips the upload until readyRead or readChannelFinished.
+    bool waiting = false;
+    bool bodyFinished = false;
+    qint64 size = 0;
+  };
+
+  void pump();
+  void resume(const QString &uploadId, bool bodyFinished);
+  void finish(const Upload &upload, bool ok);
+
+  QString m_token;
+  QHash<QString, QPointer<QIODevice>> m_sinks;
+  QList<Upload> m_uploads;
+  QTimer *m_pumpTimer = nullptr;
+  QByteArray m_buffer;
+};
@@ -0,0 +1,173 @@
+#include "WebRootWatcher.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+
+WebRootWatcher::WebRootWatcher(QObject *parent)
+    : QObject(parent), m_watcher(new QFileSystemWatcher(this)) {
+  connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &WebRootWatcher::rescan);
+  connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &WebRootWatcher::fileChanged);
+}
+
+void WebRootWatcher::setRoot(const QString &root) {
+  const QStringList watched = m_watcher->directories() + m_watcher->files();
+  if (!watched.isEmpty()) {
+    m_watcher->removePaths(watched);
+  }
+  m_snapshots.clear();
+  m_files.clear();
+  m_root = root.isEmpty() ? QString() : QDir(root).absolutePath();
+  if (!m_root.isEmpty() && QFileInfo(m_root).isDir()) {
+    addTree(m_root, nullptr);
+  }
+}
+
+QString WebRootWatcher::root() const {
+  return m_root;
+}
+
+QStringList WebRootWatcher::files() const {
+  QStringList paths;
+  for (auto it = m_snapshots.cbegin(); it != m_snapshots.cend(); ++it) {
+    for (auto file = it.value().cbegin(); file != it.value().cend(); ++file) {
+      paths.append(it.key() + QLatin1Char('/') + file.key());
+    }
+  }
+  return paths;
+}
+
+void WebRootWatcher::watchFile(const QString &path) {
+  if (m_files.contains(path) || !QFileInfo(path).isFile()) {
+    return;
+  }
+  m_files.insert(path);
+  m_watcher->addPath(path);
+}
+
+void WebRootWatcher::unwatchFiles() {
+  const QStringList files = m_watcher->files();
+  if (!files.isEmpty()) {
+    m_watcher->removePaths(files);
+  }
+  m_files.clear();
+}
+
+WebRootWatcher::Snapshot WebRootWatcher::scan(const QString &directory,
+                                              QStringList *subdirectories) const {
+  Snapshot snapshot;
+  const QFileInfoList entries =
+      QDir(directory).entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+  for (const QFileInfo &entry : entries) {
+    if (entry.isDir()) {
+      subdirectories->append(entry.absoluteFilePath());
+    } else {
+      snapshot.insert(entry.fileName(), {entry.size(), entry.lastModified()});
+    }
+  }
+  return snapshot;
+}
+
+void WebRootWatcher::addTree(const QString &directory, QStringList *addedFiles) {
+  QStringList pending{directory};
+  QStringList directories;
+  while (!pending.isEmpty()) {
+    const QString current = pending.takeLast();
+    QStringList subdirectories;
+    const Snapshot snapshot = scan(current, &subdirectories);
+    if (addedFiles) {
+      for (auto it = snapshot.cbegin(); it != snapshot.cend(); ++it) {
+        addedFiles->append(current + QLatin1Char('/') + it.key());
+      }
+    }
+    m_snapshots.insert(current, snapshot);
+    directories.append(current);
+    pending.append(subdirectories);
+  }
+  m_watcher->addPaths(directories);
+}
+
+void WebRootWatcher::removeTree(const QString &directory, QStringList *removedFiles) {
+  const QString prefix = directory + QLatin1Char('/');
+  QStringList directories;
+  for (auto it = m_snapshots.begin(); it != m_snapshots.end();) {
+    if (it.key() != directory && !it.key().startsWith(prefix)) {
+      ++it;
+      continue;
+    }
+    for (auto file = it.value().cbegin(); file != it.value().cend(); ++file) {
+      const QString path = it.key() + QLatin1Char('/') + file.key();
+      removedFiles->append(path);
+      if (m_files.remove(path)) {
+        m_watcher->removePath(path);
+      }
+    }
+    directories.append(it.key());
+    it = m_snapshots.erase(it);
+  }
+  if (!directories.isEmpty()) {
+    m_watcher->removePaths(directories);
+  }
+}
+
+void WebRootWatcher::rescan(const QString &directory) {
+  QStringList changed;
+  if (!QFileInfo(directory).isDir()) {
+    removeTree(directory, &changed);
+  } else {
+    QStringList subdirectories;
+    const Snapshot current = scan(directory, &subdirectories);
+    const Snapshot previous = m_snapshots.value(directory);
+    for (auto it = current.cbegin(); it != current.cend(); ++it) {
+      const auto before = previous.constFind(it.key());
+      if (before == previous.cend() || before->size != it->size ||
+          before->modified != it->modified) {
+        changed.append(directory + QLatin1Char('/') + it.key());
+      }
+    }
+    for (auto it = previous.cbegin(); it != previous.cend(); ++it) {
+      if (!current.contains(it.key())) {
+        changed.append(directory + QLatin1Char('/') + it.key());
+      }
+    }
+    m_snapshots.insert(directory, current);
+
+    // Only direct children can have appeared or vanished with this event.
+    for (const QString &subdirectory : std::as_const(subdirectories)) {
+      if (!m_snapshots.contains(subdirectory)) {
+        addTree(subdirectory, &changed);
+      }
+    }
+    const QString prefix = directory + QLatin1Char('/');
+    QStringList vanished;
+    for (auto it = m_snapshots.cbegin(); it != m_snapshots.cend(); ++it) {
+      const QString &watched = it.key();
+      if (watched.startsWith(prefix) && !watched.mid(prefix.size()).contains(QLatin1Char('/')) &&
+          !subdirectories.contains(watched)) {
+        vanished.append(watched);
+      }
+    }
+    for (const QString &subdirectory : std::as_const(vanished)) {
+      removeTree(subdirectory, &changed);
+    }
+  }
+
+  emit directoryChanged(directory);
+  if (!changed.isEmpty()) {
+    emit filesChanged(changed);
+  }
+}
+
+void WebRootWatcher::fileChanged(const QString &path) {
+  const QFileInfo info(path);
+  // Build tools often replace files by renaming, which drops the watch; add it back.
+  if (info.isFile() && !m_watcher->files().contains(path)) {
+    m_watcher->addPath(path);
+  }
+  // Record the new state so the directory event for the same write is not reported again.
+  const auto snapshot = m_snapshots.find(info.absolutePath());
+  if (snapshot != m_snapshots.end() && info.isFile()) {
+    snapshot->insert(info.fileName(), {info.size(), info.lastModified()});
+  }
+  emit filesChanged({path});
+}
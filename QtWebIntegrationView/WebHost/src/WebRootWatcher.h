@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class QFileSystemWatcher;
+
+// Watches the directory tree of a web root with one QFileSystemWatcher. The tree is walked once
+// per setRoot; afterwards a directory event rescans only that directory, adding or dropping the
+// subtrees that appeared or vanished, and reports the files whose name, size or modification time
+// changed. Individual files can be watched as well, for writes a directory watch does not report.
+class WebRootWatcher : public QObject {
+  Q_OBJECT
+
+public:
+  explicit WebRootWatcher(QObject *parent = nullptr);
+
+  // An empty or missing root stops all watching.
+  void setRoot(const QString &root);
+  QString root() const;
+
+  // Absolute paths of the files currently known under the root.
+  QStringList files() const;
+
+  void watchFile(const QString &path);
+  void unwatchFiles();
+
+signals:
+  // Emitted after the watcher has updated itself for the change.
+  void directoryChanged(QString path);
+  // Absolute paths of files added, removed or modified.
+  void filesChanged(QStringList paths);
+
+private:
+  struct FileState {
+    qint64 size = 0;
+    QDateTime modified;
+  };
+  using Snapshot = QHash<QString, FileState>;
+
+  Snapshot scan(const QString &directory, QStringList *subdirectories) const;
+  void addTree(const QString &directory, QStringList *addedFiles);
+  void removeTree(const QString &directory, QStringList *removedFiles);
+  void rescan(const QString &directory);
+  void fileChanged(const QString &path);
+
+  QFileSystemWatcher *m_watcher = nullptr;
+  QString m_root;
+  // Files per watched directory, keyed by file name.
+  QHash<QString, Snapshot> m_snapshots;
+  QSet<QString> m_files;
+};
@@ -106,9 +106,9 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
   });
 
   connect(m_btnA, &QPushButton::clicked, this,
-          [this]() { m_webHost->slotTriggerEvent("actionOne"); });
+          [this]() { m_webHost->triggerEvent(HostApiEvent::ActionOne); });
   connect(m_btnB, &QPushButton::clicked, this,
-          [this]() { m_webHost->slotTriggerEvent("actionTwo"); });
+          [this]() { m_webHost->triggerEvent(HostApiEvent::ActionTwo); });
 }
 
 void MainWindow::handleSendData(const QJsonValue &value) {
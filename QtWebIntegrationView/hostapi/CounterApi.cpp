@@ -0,0 +1,13 @@
+#include "CounterApi.h"
+
+CounterApi::CounterApi(QObject *parent) : QObject(parent) {}
+
+int CounterApi::increment() {
+  ++m_value;
+  emit valueChanged(m_value);
+  return m_value;
+}
+
+int CounterApi::value() const {
+  return m_value;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QObject>
+
+#include "HostApiMacros.h"
+
+class CounterApi : public QObject {
+  Q_OBJECT
+  HOSTAPI_EXPOSE
+  HOSTAPI_NAME("counter")
+  HOSTAPI_SHARED
+
+public:
+  explicit CounterApi(QObject *parent = nullptr);
+
+  Q_INVOKABLE int increment();
+  Q_INVOKABLE int value() const;
+
+signals:
+  void valueChanged(int value);
+
+private:
+  int m_value = 0;
+};
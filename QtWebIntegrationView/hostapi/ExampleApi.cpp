@@ -1,5 +1,11 @@
 #include "ExampleApi.h"
 
+#include <QPromise>
+#include <QThread>
+#include <QTimer>
+
+#include <memory>
+
 ExampleApi::ExampleApi(QObject *parent) : QObject(parent) {}
 
 QString ExampleApi::echo(const QString &text) {
@@ -10,6 +16,22 @@ int ExampleApi::add(int a, int b) {
   return a + b;
 }
 
+QFuture<QString> ExampleApi::delayedEcho(const QString &text, int delayMs) {
+  auto promise = std::make_shared<QPromise<QString>>();
+  QFuture<QString> future = promise->future();
+  promise->start();
+  QTimer::singleShot(qMax(0, delayMs), this, [promise, text]() {
+    promise->addResult(text);
+    promise->finish();
+  });
+  return future;
+}
+
+int ExampleApi::slowAdd(int a, int b, int delayMs) {
+  QThread::msleep(static_cast<unsigned long>(qMax(0, delayMs)));
+  return a + b;
+}
+
 void ExampleApi::setStatus(const QString &status) {
   if (status == m_status) {
     return;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QFuture>
 #include <QObject>
 #include <QString>
 
@@ -9,12 +10,15 @@ class ExampleApi : public QObject {
   Q_OBJECT
   HOSTAPI_EXPOSE
   HOSTAPI_NAME("example")
+  HOSTAPI_THREADED_METHOD("slowAdd")
 
 public:
   explicit ExampleApi(QObject *parent = nullptr);
 
   Q_INVOKABLE QString echo(const QString &text);
   Q_INVOKABLE int add(int a, int b);
+  Q_INVOKABLE QFuture<QString> delayedEcho(const QString &text, int delayMs);
+  Q_INVOKABLE int slowAdd(int a, int b, int delayMs);
 
 public slots:
   void setStatus(const QString &status);
@@ -2,4 +2,5 @@
 
 // List of HostApi-exposed classes (Type, exportName).
 #define HOSTAPI_CLASS_LIST(X) \
-  X(ExampleApi, "example")
+  X(ExampleApi, "example") \
+  X(CounterApi, "counter")
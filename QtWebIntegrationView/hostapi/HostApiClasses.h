@@ -1,3 +1,4 @@
 #pragma once
 
+#include "CounterApi.h"
 #include "ExampleApi.h"
@@ -7,3 +7,23 @@
 // Optional explicit name override for HostApi export.
 #define HOSTAPI_NAME(name) \
   Q_CLASSINFO("HostApi.Name", name)
+
+// Constructs the class together with its WebHost. Without it the instance is created when the page
+// first touches HostApi.<name> or calls one of its methods.
+#define HOSTAPI_EAGER \
+  Q_CLASSINFO("HostApi.Eager", "true")
+
+// Uses one process-wide instance for every WebHost instead of one per host. Its signals are relayed
+// to each page that has accessed the object since its last load, with the arguments converted to
+// JSON text once per emission rather than once per channel.
+#define HOSTAPI_SHARED \
+  Q_CLASSINFO("HostApi.Shared", "true")
+
+// Runs every HostApi call on this class on a QThreadPool worker; results are marshalled back to
+// the GUI thread before they reach the channel. The class must be safe to call from any thread.
+#define HOSTAPI_THREADED \
+  Q_CLASSINFO("HostApi.Threaded", "true")
+
+// Runs a single HostApi method (by name) on a QThreadPool worker. May be repeated.
+#define HOSTAPI_THREADED_METHOD(method) \
+  Q_CLASSINFO("HostApi.ThreadedMethod", method)
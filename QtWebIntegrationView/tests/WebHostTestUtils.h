@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QSignalSpy>
+#include <QTest>
+#include <QVariant>
+#include <QWebEnginePage>
+#include <QWebEngineView>
+
+#include "WebHost/WebHost.h"
+
+// Helpers shared by the headless WebEngine test and benchmark executables.
+
+inline QVariant runJavaScriptSync(QWebEnginePage *page, const QString &script) {
+  QVariant result;
+  QEventLoop loop;
+  page->runJavaScript(script, [&](const QVariant &value) {
+    result = value;
+    loop.quit();
+  });
+  loop.exec();
+  return result;
+}
+
+inline bool waitForLoad(QWebEngineView *view, int timeoutMs) {
+  if (!view->page()->isLoading()) {
+    return true;
+  }
+
+  QSignalSpy spy(view, &QWebEngineView::loadFinished);
+  return spy.wait(timeoutMs);
+}
+
+inline bool waitForHostApiReady(WebHost *host, int timeoutMs) {
+  if (host->isHostApiReady()) {
+    return true;
+  }
+
+  QSignalSpy spy(host, &WebHost::signalHostApiReady);
+  return spy.wait(timeoutMs);
+}
+
+inline void configureHeadlessWebEngine() {
+  qputenv("QT_QPA_PLATFORM", "offscreen");
+  qputenv("QTWEBENGINE_CHROMIUM_FLAGS",
+          "--no-sandbox --disable-setuid-sandbox --disable-gpu --headless "
+          "--disable-software-rasterizer --disable-dev-shm-usage");
+  qputenv("QTWEBENGINE_DISABLE_SANDBOX", "1");
+  QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+}
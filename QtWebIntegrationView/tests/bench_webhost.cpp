@@ -0,0 +1,441 @@
+#include <QApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QScopeGuard>
+#include <QSignalSpy>
+#include <QTest>
+#include <QWebEnginePage>
+#include <QWebEngineView>
+
+#include <memory>
+#include <vector>
+
+#include "WebHost/WebHost.h"
+#include "WebHost/WebHostGroup.h"
+#include "ExampleApi.h"
+#include "HostApiGenerated.h"
+#include "WebHostTestUtils.h"
+
+namespace {
+
+// Resident set size in KiB of this process and all of its descendants, which include the
+// QtWebEngineProcess zygote and renderers. Returns -1 where /proc is not available.
+qint64 processTreeRssKiB() {
+#ifdef Q_OS_LINUX
+  QHash<qint64, qint64> parents;
+  QHash<qint64, qint64> rssKiB;
+  const QStringList entries = QDir(QStringLiteral("/proc")).entryList(QDir::Dirs);
+  for (const QString &entry : entries) {
+    bool isPid = false;
+    const qint64 pid = entry.toLongLong(&isPid);
+    QFile status(QStringLiteral("/proc/%1/status").arg(entry));
+    if (!isPid || !status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      continue;
+    }
+    for (const QByteArray &line : status.readAll().split('\n')) {
+      if (line.startsWith("PPid:")) {
+        parents.insert(pid, line.mid(5).trimmed().toLongLong());
+      } else if (line.startsWith("VmRSS:")) {
+        rssKiB.insert(pid, line.mid(6).trimmed().split(' ').first().toLongLong());
+      }
+    }
+  }
+
+  const qint64 self = QCoreApplication::applicationPid();
+  qint64 total = 0;
+  for (auto it = rssKiB.cbegin(); it != rssKiB.cend(); ++it) {
+    for (qint64 pid = it.key(); pid > 1; pid = parents.value(pid)) {
+      if (pid == self) {
+        total += it.value();
+        break;
+      }
+    }
+  }
+  return total;
+#else
+  return -1;
+#endif
+}
+
+} // namespace
+
+class WebHostBenchmarks : public QObject {
+  Q_OBJECT
+
+private slots:
+  void benchmarkEventDispatch_data();
+  void benchmarkEventDispatch();
+  void benchmarkChannelTransport_data();
+  void benchmarkChannelTransport();
+  void benchmarkColdLoad_data();
+  void benchmarkColdLoad();
+  void benchmarkGroupBroadcast_data();
+  void benchmarkGroupBroadcast();
+  void benchmarkProfileMemory_data();
+  void benchmarkProfileMemory();
+  void benchmarkHostApiDispatch_data();
+  void benchmarkHostApiDispatch();
+};
+
+void WebHostBenchmarks::benchmarkEventDispatch_data() {
+  QTest::addColumn<bool>("channelDispatch");
+  QTest::newRow("Script") << false;
+  QTest::newRow("Channel") << true;
+}
+
+void WebHostBenchmarks::benchmarkEventDispatch() {
+  QFETCH(bool, channelDispatch);
+  constexpr int kEventCount = 2000;
+
+  WebHost host;
+  host.setEventDispatchMode(channelDispatch ? WebHost::EventDispatchMode::Channel
+                                            : WebHost::EventDispatchMode::Script);
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  runJavaScriptSync(view->page(),
+                    "window.__benchCount = 0;"
+                    "window.HostApi.addEventListener('actionOne', function() {"
+                    "  window.__benchCount++;"
+                    "});");
+  QTRY_VERIFY(host.hasEventSubscribers("actionOne"));
+
+  QJsonObject payload;
+  payload.insert("value", 42);
+  payload.insert("label", "tick");
+
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < kEventCount; ++i) {
+    host.slotTriggerEvent("actionOne", payload);
+  }
+  QTRY_COMPARE_WITH_TIMEOUT(runJavaScriptSync(view->page(), "window.__benchCount;").toInt(),
+                            kEventCount, 60000);
+  const qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+
+  qInfo() << "Event dispatch" << QTest::currentDataTag() << kEventCount << "events in"
+          << elapsedMs << "ms =" << (kEventCount * 1000.0 / elapsedMs) << "events/sec";
+}
+
+void WebHostBenchmarks::benchmarkChannelTransport_data() {
+  QTest::addColumn<bool>("cborTransport");
+  QTest::addColumn<int>("payloadBytes");
+  QTest::newRow("Json 1MB") << false << (1 << 20);
+  QTest::newRow("Cbor 1MB") << true << (1 << 20);
+  QTest::newRow("Json 10MB") << false << (10 << 20);
+  QTest::newRow("Cbor 10MB") << true << (10 << 20);
+}
+
+void WebHostBenchmarks::benchmarkChannelTransport() {
+  QFETCH(bool, cborTransport);
+  QFETCH(int, payloadBytes);
+  constexpr int kIterations = 5;
+
+  WebHost host;
+  host.setChannelTransport(cborTransport ? WebHost::ChannelTransport::Cbor
+                                         : WebHost::ChannelTransport::Json);
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  // JS -> host: sendData with a large string payload.
+  runJavaScriptSync(view->page(),
+                    QStringLiteral("window.__benchPayload = 'x'.repeat(%1);").arg(payloadBytes));
+  QSignalSpy sendSpy(&host, &WebHost::signalSendData);
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < kIterations; ++i) {
+    runJavaScriptSync(view->page(), "window.HostApi.sendData(window.__benchPayload);");
+    QVERIFY(sendSpy.count() > i || sendSpy.wait(60000));
+  }
+  const qint64 sendMs = qMax<qint64>(1, timer.elapsed());
+  QCOMPARE(sendSpy.last().at(0).toJsonValue().toString().size(), payloadBytes);
+
+  // Host -> JS: events with the same payload, acknowledged through setOutput.
+  runJavaScriptSync(view->page(),
+                    "window.HostApi.addEventListener('actionOne', function(payload) {"
+                    "  window.HostApi.setOutput(String(payload.length));"
+                    "});");
+  QTRY_VERIFY(host.hasEventSubscribers("actionOne"));
+  const QJsonValue payload(QString(payloadBytes, QLatin1Char('x')));
+  QSignalSpy outputSpy(&host, &WebHost::signalSetOutput);
+  timer.restart();
+  for (int i = 0; i < kIterations; ++i) {
+    host.slotTriggerEvent("actionOne", payload);
+    QVERIFY(outputSpy.count() > i || outputSpy.wait(60000));
+  }
+  const qint64 eventMs = qMax<qint64>(1, timer.elapsed());
+  QCOMPARE(outputSpy.last().at(0).toString().toInt(), payloadBytes);
+
+  qInfo() << "Channel transport" << QTest::currentDataTag() << "sendData"
+          << (sendMs / double(kIterations)) << "ms/call, event" << (eventMs / double(kIterations))
+          << "ms/call";
+}
+
+void WebHostBenchmarks::benchmarkColdLoad_data() {
+  QTest::addColumn<bool>("schemeRoot");
+  QTest::newRow("Qrc") << false;
+  QTest::newRow("Scheme") << true;
+}
+
+// Only the first WebHost in a process pays for WebEngine start-up; for comparable numbers run one
+// row per process, e.g. "WebHostBenchmarks benchmarkColdLoad:Scheme".
+void WebHostBenchmarks::benchmarkColdLoad() {
+  QFETCH(bool, schemeRoot);
+
+  QElapsedTimer timer;
+  timer.start();
+  WebHost host;
+  if (schemeRoot) {
+    host.setRootScheme(WebHost::AssetSource::Qrc);
+  } else {
+    host.setRootQrc();
+  }
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+  qInfo() << "Cold load" << QTest::currentDataTag() << timer.elapsed() << "ms to HostApi";
+}
+
+void WebHostBenchmarks::benchmarkGroupBroadcast_data() {
+  QTest::addColumn<bool>("channelDispatch");
+  QTest::newRow("Script") << false;
+  QTest::newRow("Channel") << true;
+}
+
+// Sends the same events to the same hosts once host by host and once through a group, and
+// compares the time spent in the send loops.
+void WebHostBenchmarks::benchmarkGroupBroadcast() {
+  QFETCH(bool, channelDispatch);
+  constexpr int kHostCount = 8;
+  constexpr int kEventCount = 200;
+
+  std::vector<std::unique_ptr<WebHost>> hosts;
+  WebHostGroup group;
+  for (int i = 0; i < kHostCount; ++i) {
+    hosts.push_back(std::make_unique<WebHost>());
+    hosts.back()->setEventDispatchMode(channelDispatch ? WebHost::EventDispatchMode::Channel
+                                                       : WebHost::EventDispatchMode::Script);
+    hosts.back()->show();
+    auto *view = hosts.back()->findChild<QWebEngineView *>();
+    QVERIFY(view != nullptr);
+    QVERIFY(waitForLoad(view, 20000));
+    QVERIFY(waitForHostApiReady(hosts.back().get(), 5000));
+    runJavaScriptSync(view->page(),
+                      "window.__benchCount = 0;"
+                      "window.HostApi.addEventListener('actionOne', function() {"
+                      "  window.__benchCount++;"
+                      "});");
+    QTRY_VERIFY(hosts.back()->hasEventSubscribers("actionOne"));
+    group.addHost(hosts.back().get());
+  }
+
+  QJsonArray rows;
+  for (int i = 0; i < 500; ++i) {
+    rows.append(
+        QJsonObject{{"id", i}, {"label", QStringLiteral("row %1").arg(i)}, {"value", i * 0.5}});
+  }
+  const QJsonObject payload{{"rows", rows}};
+
+  auto waitForDelivery = [&hosts](int expected) {
+    for (const auto &host : hosts) {
+      auto *view = host->findChild<QWebEngineView *>();
+      QTRY_COMPARE_WITH_TIMEOUT(runJavaScriptSync(view->page(), "window.__benchCount;").toInt(),
+                                expected, 60000);
+    }
+  };
+
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < kEventCount; ++i) {
+    for (const auto &host : hosts) {
+      host->slotTriggerEvent("actionOne", payload);
+    }
+  }
+  const qint64 perHostMs = qMax<qint64>(1, timer.elapsed());
+  waitForDelivery(kEventCount);
+  if (QTest::currentTestFailed()) {
+    return;
+  }
+
+  timer.restart();
+  for (int i = 0; i < kEventCount; ++i) {
+    group.slotTriggerEvent("actionOne", payload);
+  }
+  const qint64 groupMs = qMax<qint64>(1, timer.elapsed());
+  waitForDelivery(2 * kEventCount);
+  if (QTest::currentTestFailed()) {
+    return;
+  }
+
+  qInfo() << "Group broadcast" << QTest::currentDataTag() << kEventCount << "events to"
+          << kHostCount << "hosts: per host" << perHostMs << "ms, group" << groupMs << "ms ="
+          << (double(perHostMs) / groupMs) << "x";
+  // Script hosts share one dispatch script per event, so the group must not be slower. Channel
+  // hosts each encode the payload either way; their numbers are reported only.
+  if (!channelDispatch) {
+    QVERIFY2(groupMs <= perHostMs,
+             qPrintable(QStringLiteral("group %1 ms, per host %2 ms").arg(groupMs).arg(perHostMs)));
+  }
+}
+
+void WebHostBenchmarks::benchmarkProfileMemory_data() {
+  QTest::addColumn<bool>("sharedProfile");
+  QTest::newRow("PerInstance") << false;
+  QTest::newRow("Shared") << true;
+}
+
+// Renderer processes and profiles are released lazily, so run one row per process, e.g.
+// "WebHostBenchmarks benchmarkProfileMemory:Shared"; ctest registers each row separately.
+void WebHostBenchmarks::benchmarkProfileMemory() {
+  QFETCH(bool, sharedProfile);
+  constexpr int kHostCount = 10;
+
+  const qint64 baselineKiB = processTreeRssKiB();
+  if (baselineKiB < 0) {
+    QSKIP("Process tree memory is only measured on Linux.");
+  }
+
+  WebHost::setDefaultProfileMode(sharedProfile ? WebHost::ProfileMode::Shared
+                                               : WebHost::ProfileMode::PerInstance);
+  const auto restoreMode = qScopeGuard(
+      []() { WebHost::setDefaultProfileMode(WebHost::ProfileMode::PerInstance); });
+
+  QElapsedTimer timer;
+  timer.start();
+  std::vector<std::unique_ptr<WebHost>> hosts;
+  for (int i = 0; i < kHostCount; ++i) {
+    hosts.push_back(std::make_unique<WebHost>());
+    hosts.back()->show();
+    auto *view = hosts.back()->findChild<QWebEngineView *>();
+    QVERIFY(view != nullptr);
+    QVERIFY(waitForLoad(view, 20000));
+    QVERIFY(waitForHostApiReady(hosts.back().get(), 5000));
+  }
+  const qint64 loadMs = timer.elapsed();
+
+  // Let renderers finish their post-load work before sampling.
+  QTest::qWait(1000);
+  const qint64 loadedKiB = processTreeRssKiB();
+  qInfo() << "Profile memory" << QTest::currentDataTag() << kHostCount << "hosts loaded in"
+          << loadMs << "ms, RSS" << (loadedKiB / 1024.0) << "MiB total,"
+          << ((loadedKiB - baselineKiB) / 1024.0) << "MiB over baseline";
+}
+
+void WebHostBenchmarks::benchmarkHostApiDispatch_data() {
+  QTest::addColumn<QString>("method");
+  QTest::addColumn<bool>("indexed");
+  QTest::addColumn<bool>("fromPage");
+  QTest::newRow("add by name") << QStringLiteral("add") << false << false;
+  QTest::newRow("add by index") << QStringLiteral("add") << true << false;
+  QTest::newRow("echo by name") << QStringLiteral("echo") << false << false;
+  QTest::newRow("echo by index") << QStringLiteral("echo") << true << false;
+  QTest::newRow("add by name from page") << QStringLiteral("add") << false << true;
+  QTest::newRow("add by index from page") << QStringLiteral("add") << true << true;
+  QTest::newRow("echo by name from page") << QStringLiteral("echo") << false << true;
+  QTest::newRow("echo by index from page") << QStringLiteral("echo") << true << true;
+}
+
+// The plain rows measure the generated C++ dispatch alone. The "from page" rows time calls made
+// in JS until their promises settle, so they include the channel hop both ways: rpcCall or
+// rpcCallIndexed crosses QWebChannel like any Q_INVOKABLE, and only the lookup behind it differs.
+void WebHostBenchmarks::benchmarkHostApiDispatch() {
+  QFETCH(QString, method);
+  QFETCH(bool, indexed);
+  QFETCH(bool, fromPage);
+  const QJsonArray args = method == QLatin1String("add") ? QJsonArray{20, 22}
+                                                         : QJsonArray{QStringLiteral("ping")};
+
+  if (fromPage) {
+    constexpr int kCallCount = 5000;
+    WebHost host;
+    host.show();
+    auto *view = host.findChild<QWebEngineView *>();
+    QVERIFY(view != nullptr);
+    QVERIFY(waitForLoad(view, 10000));
+    QVERIFY(waitForHostApiReady(&host, 5000));
+
+    // Calls are pipelined, as independent calls from an app are.
+    const QString call = indexed ? QStringLiteral("window.HostApi.example.%1.apply(null, args)")
+                                       .arg(method)
+                                 : QStringLiteral("window.HostApi.__callByName('example', '%1', "
+                                                  "args)")
+                                       .arg(method);
+    runJavaScriptSync(
+        view->page(),
+        QStringLiteral("window.__dispatchMs = null;"
+                       "(function() {"
+                       "  var args = %1;"
+                       "  var calls = [];"
+                       "  var start = performance.now();"
+                       "  for (var i = 0; i < %2; i++) { calls.push(%3); }"
+                       "  Promise.all(calls).then(function() {"
+                       "    window.__dispatchMs = performance.now() - start;"
+                       "  }, function(error) { window.__dispatchMs = -1; });"
+                       "})();")
+            .arg(QString::fromUtf8(QJsonDocument(args).toJson(QJsonDocument::Compact)))
+            .arg(kCallCount)
+            .arg(call));
+    QTRY_VERIFY_WITH_TIMEOUT(!runJavaScriptSync(view->page(), "window.__dispatchMs;").isNull(),
+                             60000);
+    const double elapsedMs = runJavaScriptSync(view->page(), "window.__dispatchMs;").toDouble();
+    QVERIFY(elapsedMs >= 0);
+    qInfo() << "HostApi dispatch" << QTest::currentDataTag() << kCallCount << "calls in"
+            << elapsedMs << "ms =" << (elapsedMs * 1000.0 / kCallCount) << "us/call";
+    return;
+  }
+
+  constexpr int kCallCount = 200000;
+  ExampleApi api;
+  const HostApiObjectInfo object{QStringLiteral("example"), &api, {}, false};
+  const int methodIndex = hostApiMethodIndex(object.name, method, args.size());
+  QVERIFY(methodIndex >= 0);
+
+  int resolved = 0;
+  const HostApiRpcCallback done = [&resolved](const HostApiRpcResult &result) {
+    if (result.ok) {
+      ++resolved;
+    }
+  };
+
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < kCallCount; ++i) {
+    if (indexed) {
+      invokeHostApiMethodIndex(object, methodIndex, args, done);
+    } else {
+      invokeHostApiMethod(object, method, args, done);
+    }
+  }
+  const qint64 elapsedNs = qMax<qint64>(1, timer.nsecsElapsed());
+  QCOMPARE(resolved, kCallCount);
+
+  qInfo() << "HostApi dispatch" << QTest::currentDataTag() << kCallCount << "calls in"
+          << (elapsedNs / 1000000.0) << "ms =" << (double(elapsedNs) / kCallCount) << "ns/call";
+}
+
+int main(int argc, char **argv) {
+  configureHeadlessWebEngine();
+  WebHost::registerUrlScheme();
+
+  QApplication app(argc, argv);
+  WebHostBenchmarks benchmarks;
+  return QTest::qExec(&benchmarks, argc, argv);
+}
+
+#include "bench_webhost.moc"
@@ -1,75 +1,94 @@
 #include <QApplication>
+#include <QBuffer>
+#include <QDir>
 #include <QElapsedTimer>
-#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
 #include <QJsonObject>
-#include <QSignalSpy>
+#include <QRegularExpression>
+#include <QScopeGuard>
+#include <QTemporaryDir>
 #include <QTest>
+#include <QTimer>
 #include <QWebEnginePage>
+#include <QWebEngineProfile>
+#include <QWebEngineScript>
+#include <QWebEngineScriptCollection>
 #include <QWebEngineView>
 
+#include <memory>
+
 #include "WebHost/WebHost.h"
+#include "WebHost/WebHostGroup.h"
+#include "WebHost/WebHostPool.h"
 #include "HostApiVersion.h"
-
-namespace {
-
-QVariant runJavaScriptSync(QWebEnginePage *page, const QString &script) {
-  QVariant result;
-  QEventLoop loop;
-  page->runJavaScript(script, [&](const QVariant &value) {
-    result = value;
-    loop.quit();
-  });
-  loop.exec();
-  return result;
-}
-
-bool waitForLoad(QWebEngineView *view, int timeoutMs) {
-  if (!view->page()->isLoading()) {
-    return true;
-  }
-
-  QSignalSpy spy(view, &QWebEngineView::loadFinished);
-  return spy.wait(timeoutMs);
-}
-
-bool waitForHostApi(QWebEnginePage *page, int timeoutMs) {
-  QElapsedTimer timer;
-  timer.start();
-  while (timer.elapsed() < timeoutMs) {
-    QVariant ready = runJavaScriptSync(page, "typeof window.HostApi !== 'undefined'");
-    if (ready.toBool()) {
-      return true;
-    }
-    QTest::qWait(50);
-  }
-  return false;
-}
-
-} // namespace
+#include "WebHostTestUtils.h"
 
 class WebHostTests : public QObject {
   Q_OBJECT
 
 private slots:
+  void testAddRemoveListeners_data();
   void testAddRemoveListeners();
   void testRemoveInvalidEventType();
+  void testTriggerEventById();
+  void testEventBatching();
+  void testPreReadyEventQueue();
+  void testWebHostGroup();
   void testHostApiVersion();
+  void testHostApiSchemaHash();
   void testExampleApi();
+  void testLazyHostApiObjects();
+  void testSharedHostApiObject();
+  void testRpc();
+  void testRpcArgumentTypes_data();
+  void testRpcArgumentTypes();
+  void testThreadedInvokable();
+  void testDestroyDuringThreadedCall();
+  void testCborChannelTransport();
+  void testBlobDownload();
+  void testUploadStreaming();
+  void testStreamBackpressure();
+  void testSchemeRoot_data();
+  void testSchemeRoot();
+  void testSchemeRootFollowsDisk();
+  void testPackRoot();
+  void testFileRequestCache();
+  void testHotReload();
+  void testWebHostPool();
+  void testWebHostPoolFailedWarmup();
+  void testWebHostPoolDestroyedAfterAcquire();
+  void testSharedProfile_data();
+  void testSharedProfile();
+  void testBootstrapStartupLatency_data();
+  void testBootstrapStartupLatency();
 };
 
+void WebHostTests::testAddRemoveListeners_data() {
+  QTest::addColumn<bool>("channelDispatch");
+  QTest::newRow("Script") << false;
+  QTest::newRow("Channel") << true;
+}
+
 void WebHostTests::testAddRemoveListeners() {
+  QFETCH(bool, channelDispatch);
+
   WebHost host;
+  host.setEventDispatchMode(channelDispatch ? WebHost::EventDispatchMode::Channel
+                                            : WebHost::EventDispatchMode::Script);
   host.show();
 
   auto *view = host.findChild<QWebEngineView *>();
   QVERIFY(view != nullptr);
   QVERIFY(waitForLoad(view, 10000));
-  QVERIFY(waitForHostApi(view->page(), 5000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
 
   runJavaScriptSync(view->page(),
                     "window.__testCount = 0;"
                     "window.__handler = function(payload) { window.__testCount++; };"
                     "window.HostApi.addEventListener('actionOne', window.__handler);");
+  QTRY_VERIFY(host.hasEventSubscribers("actionOne"));
+  QVERIFY(!host.hasEventSubscribers("actionTwo"));
 
   QJsonObject payload;
   payload.insert("value", 42);
@@ -81,12 +100,24 @@ void WebHostTests::testAddRemoveListeners() {
 
   runJavaScriptSync(view->page(),
                     "window.HostApi.removeEventListener('actionOne', window.__handler);");
+  QTRY_VERIFY(!host.hasEventSubscribers("actionOne"));
 
   host.slotTriggerEvent("actionOne", payload);
   QTest::qWait(100);
 
   count = runJavaScriptSync(view->page(), "window.__testCount;");
   QCOMPARE(count.toInt(), 1);
+
+  // No count for actionTwo has reached the host yet, so an event triggered right after the
+  // listener is added is delivered rather than dropped.
+  runJavaScriptSync(view->page(),
+                    "window.__twoCount = 0;"
+                    "window.HostApi.addEventListener('actionTwo', function() {"
+                    "  window.__twoCount++;"
+                    "});");
+  host.slotTriggerEvent("actionTwo", payload);
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__twoCount;").toInt(), 1);
+  QTRY_VERIFY(host.hasEventSubscribers("actionTwo"));
 }
 
 void WebHostTests::testRemoveInvalidEventType() {
@@ -96,7 +127,7 @@ void WebHostTests::testRemoveInvalidEventType() {
   auto *view = host.findChild<QWebEngineView *>();
   QVERIFY(view != nullptr);
   QVERIFY(waitForLoad(view, 10000));
-  QVERIFY(waitForHostApi(view->page(), 5000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
 
   QVariant result = runJavaScriptSync(
       view->page(),
@@ -106,6 +137,190 @@ void WebHostTests::testRemoveInvalidEventType() {
   QCOMPARE(result.toString(), QStringLiteral("eventType bogus not found."));
 }
 
+void WebHostTests::testTriggerEventById() {
+  WebHost host;
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+  QCOMPARE(hostApiEventName(HostApiEvent::ActionTwo), QStringLiteral("actionTwo"));
+  QCOMPARE(hostApiEventId("actionTwo"), static_cast<int>(HostApiEvent::ActionTwo));
+
+  runJavaScriptSync(view->page(),
+                    QStringLiteral("window.__twoValues = [];"
+                                   "window.HostApi.addEventListener(%1, function(payload) {"
+                                   "  window.__twoValues.push(payload.value);"
+                                   "});")
+                        .arg(static_cast<int>(HostApiEvent::ActionTwo)));
+  QTRY_VERIFY(host.hasEventSubscribers("actionTwo"));
+
+  host.triggerEvent(HostApiEvent::ActionTwo, QJsonObject{{"value", 7}});
+  QTest::ignoreMessage(QtWarningMsg, QRegularExpression("unknown event type"));
+  host.slotTriggerEvent("actionTow", QJsonObject{{"value", 8}});
+  host.slotTriggerEvent("actionTwo", QJsonObject{{"value", 9}});
+
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__twoValues.join(',');").toString(),
+               QStringLiteral("7,9"));
+}
+
+void WebHostTests::testEventBatching() {
+  WebHost host;
+  host.setEventBatchingEnabled(true);
+  host.setEventBatchInterval(50);
+  host.setEventBatchPolicy("actionTwo", WebHost::EventBatchPolicy::MergePayloads);
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  runJavaScriptSync(view->page(),
+                    "window.__oneValues = [];"
+                    "window.__twoValues = [];"
+                    "window.HostApi.addEventListener('actionOne', function(payload) {"
+                    "  window.__oneValues.push(payload.value);"
+                    "});"
+                    "window.HostApi.addEventListener('actionTwo', function(payload) {"
+                    "  window.__twoValues.push(payload);"
+                    "});");
+  QTRY_VERIFY(host.hasEventSubscribers("actionOne"));
+  QTRY_VERIFY(host.hasEventSubscribers("actionTwo"));
+
+  for (int i = 0; i < 5; ++i) {
+    QJsonObject payload;
+    payload.insert("value", i);
+    host.slotTriggerEvent("actionOne", payload);
+  }
+  QJsonObject first;
+  first.insert("a", 1);
+  first.insert("b", 1);
+  QJsonObject second;
+  second.insert("b", 2);
+  host.slotTriggerEvent("actionTwo", first);
+  host.slotTriggerEvent("actionTwo", second);
+
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__oneValues.join(',');").toString(),
+               QStringLiteral("0,1,2,3,4"));
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "JSON.stringify(window.__twoValues);").toString(),
+               QStringLiteral("[{\"a\":1,\"b\":2}]"));
+
+  host.setEventBatchPolicy("actionOne", WebHost::EventBatchPolicy::LatestOnly);
+  for (int i = 5; i < 10; ++i) {
+    QJsonObject payload;
+    payload.insert("value", i);
+    host.slotTriggerEvent("actionOne", payload);
+  }
+  host.slotFlushEvents();
+
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__oneValues.join(',');").toString(),
+               QStringLiteral("0,1,2,3,4,9"));
+}
+
+void WebHostTests::testPreReadyEventQueue() {
+  WebHost host;
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  // Subscribe from HostApiReady on the next load, the earliest point a page can listen.
+  QWebEngineScript subscribe;
+  subscribe.setName("testPreReadySubscribe");
+  subscribe.setInjectionPoint(QWebEngineScript::DocumentCreation);
+  subscribe.setWorldId(QWebEngineScript::MainWorld);
+  subscribe.setSourceCode("window.addEventListener('HostApiReady', function() {"
+                          "  window.__earlyValues = [];"
+                          "  window.HostApi.addEventListener('actionOne', function(payload) {"
+                          "    window.__earlyValues.push(payload.value);"
+                          "  });"
+                          "});");
+  view->page()->scripts().insert(subscribe);
+
+  QSignalSpy loadStarted(view->page(), &QWebEnginePage::loadStarted);
+  QSignalSpy ready(&host, &WebHost::signalHostApiReady);
+  view->page()->triggerAction(QWebEnginePage::Reload);
+  QVERIFY(loadStarted.count() > 0 || loadStarted.wait(5000));
+  QVERIFY(!host.isHostApiReady());
+
+  for (int i = 0; i < 3; ++i) {
+    QJsonObject payload;
+    payload.insert("value", i);
+    host.slotTriggerEvent("actionOne", payload);
+  }
+  host.slotTriggerEvent("actionTwo", QJsonObject{{"value", 99}});
+
+  QVERIFY(ready.wait(10000));
+  QCOMPARE(ready.first().first().toString(), hostApiVersion());
+  QVERIFY(host.isHostApiReady());
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__earlyValues.join(',');").toString(),
+               QStringLiteral("0,1,2"));
+  QVERIFY(!host.hasEventSubscribers("actionTwo"));
+}
+
+void WebHostTests::testWebHostGroup() {
+  WebHost all;
+  WebHost filtered;
+  WebHost hidden;
+  hidden.setEventDispatchMode(WebHost::EventDispatchMode::Script);
+  WebHost *hosts[3] = {&all, &filtered, &hidden};
+  QWebEnginePage *pages[3] = {};
+  for (int i = 0; i < 3; ++i) {
+    hosts[i]->show();
+    auto *view = hosts[i]->findChild<QWebEngineView *>();
+    QVERIFY(view != nullptr);
+    QVERIFY(waitForLoad(view, 10000));
+    QVERIFY(waitForHostApiReady(hosts[i], 5000));
+    pages[i] = view->page();
+    runJavaScriptSync(pages[i],
+                      "window.__events = [];"
+                      "['actionOne', 'actionTwo'].forEach(function(type) {"
+                      "  window.HostApi.addEventListener(type, function(payload) {"
+                      "    window.__events.push(type + ':' + payload.value);"
+                      "  });"
+                      "});");
+    QTRY_VERIFY(hosts[i]->hasEventSubscribers("actionTwo"));
+  }
+  hidden.hide();
+
+  WebHostGroup group;
+  group.setHiddenPolicy(WebHostGroup::HiddenPolicy::Defer);
+  for (WebHost *host : hosts) {
+    group.addHost(host);
+  }
+  group.setEventFilter(&filtered, {QStringLiteral("actionTwo")});
+  QCOMPARE(group.hosts().size(), 3);
+
+  for (int i = 0; i < 3; ++i) {
+    QJsonObject payload;
+    payload.insert("value", i);
+    group.slotTriggerEvent(i == 1 ? "actionTwo" : "actionOne", payload);
+  }
+  QTRY_COMPARE(runJavaScriptSync(pages[0], "window.__events.join(',');").toString(),
+               QStringLiteral("actionOne:0,actionTwo:1,actionOne:2"));
+  QTRY_COMPARE(runJavaScriptSync(pages[1], "window.__events.join(',');").toString(),
+               QStringLiteral("actionTwo:1"));
+
+  // Deferred events keep the latest payload per type and arrive once the host is shown.
+  QCOMPARE(group.deferredEventCount(&hidden), 2);
+  QCOMPARE(runJavaScriptSync(pages[2], "window.__events.length;").toInt(), 0);
+  hidden.show();
+  QTRY_COMPARE(runJavaScriptSync(pages[2], "window.__events.join(',');").toString(),
+               QStringLiteral("actionTwo:1,actionOne:2"));
+  QCOMPARE(group.deferredEventCount(&hidden), 0);
+
+  hidden.hide();
+  group.setHiddenPolicy(WebHostGroup::HiddenPolicy::Skip);
+  group.slotTriggerEvent("actionOne", QJsonObject{{"value", 3}});
+  QCOMPARE(group.deferredEventCount(&hidden), 0);
+  group.removeHost(&filtered);
+  QCOMPARE(group.hosts().size(), 2);
+}
+
 void WebHostTests::testHostApiVersion() {
   WebHost host;
   host.show();
@@ -113,12 +328,36 @@ void WebHostTests::testHostApiVersion() {
   auto *view = host.findChild<QWebEngineView *>();
   QVERIFY(view != nullptr);
   QVERIFY(waitForLoad(view, 10000));
-  QVERIFY(waitForHostApi(view->page(), 5000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
 
   QVariant version = runJavaScriptSync(view->page(), "window.HostApi.version;");
   QCOMPARE(version.toString(), hostApiVersion());
 }
 
+void WebHostTests::testHostApiSchemaHash() {
+  WebHost host;
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  const QString hash = runJavaScriptSync(view->page(), "window.HostApi.schemaHash;").toString();
+  QCOMPARE(hash.size(), 16);
+
+  runJavaScriptSync(view->page(),
+                    "window.__schema = null;"
+                    "window.HostApi.loadSchema().then(function(schema) {"
+                    "  window.__schema = schema;"
+                    "});");
+  QTRY_VERIFY(runJavaScriptSync(view->page(), "window.__schema !== null;").toBool());
+  QCOMPARE(runJavaScriptSync(view->page(), "window.__schema.version;").toString(),
+           hostApiVersion());
+  QVERIFY(runJavaScriptSync(view->page(), "window.__schema.objects.length;").toInt() > 0);
+  QVERIFY(runJavaScriptSync(view->page(), "window.HostApi.schema === window.__schema;").toBool());
+}
+
 void WebHostTests::testExampleApi() {
   WebHost host;
   host.show();
@@ -126,7 +365,7 @@ void WebHostTests::testExampleApi() {
   auto *view = host.findChild<QWebEngineView *>();
   QVERIFY(view != nullptr);
   QVERIFY(waitForLoad(view, 10000));
-  QVERIFY(waitForHostApi(view->page(), 5000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
 
   runJavaScriptSync(view->page(),
                     "window.__exampleValue = null;"
@@ -152,15 +391,806 @@ void WebHostTests::testExampleApi() {
   QVariant statusValue = runJavaScriptSync(view->page(), "window.__statusValue;");
   QCOMPARE(statusCount.toInt(), 1);
   QCOMPARE(statusValue.toString(), QStringLiteral("ready"));
+
+  // The generated signal table must not match names inherited from Object.prototype.
+  QVariant error = runJavaScriptSync(
+      view->page(),
+      "try { window.HostApi.example.registerEventHandler('toString', function() {}); "
+      "  'no_error'; } catch (e) { e.message; }");
+  QCOMPARE(error.toString(), QStringLiteral("eventType toString not found."));
+}
+
+void WebHostTests::testLazyHostApiObjects() {
+  WebHost host;
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  const auto exampleCount = [&host]() {
+    int count = 0;
+    for (QObject *child : host.findChildren<QObject *>(Qt::FindDirectChildrenOnly)) {
+      count += qstrcmp(child->metaObject()->className(), "ExampleApi") == 0 ? 1 : 0;
+    }
+    return count;
+  };
+  QCOMPARE(exampleCount(), 0);
+  QCOMPARE(runJavaScriptSync(view->page(), "Object.keys(window.HostApi).indexOf('example') >= 0;")
+               .toBool(),
+           true);
+  QTest::qWait(100);
+  QCOMPARE(exampleCount(), 0);
+
+  // A handler registered on first access must see the signal of a call made right after it.
+  runJavaScriptSync(view->page(),
+                    "window.__status = null;"
+                    "var api = window.HostApi.example;"
+                    "api.registerEventHandler('statusChanged', function(status) {"
+                    "  window.__status = status;"
+                    "});"
+                    "api.setStatus('lazy');");
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__status;").toString(),
+               QStringLiteral("lazy"));
+  QCOMPARE(exampleCount(), 1);
+}
+
+void WebHostTests::testSharedHostApiObject() {
+  WebHost first;
+  WebHost second;
+  QWebEnginePage *pages[2] = {};
+  WebHost *hosts[2] = {&first, &second};
+  for (int i = 0; i < 2; ++i) {
+    hosts[i]->show();
+    auto *view = hosts[i]->findChild<QWebEngineView *>();
+    QVERIFY(view != nullptr);
+    QVERIFY(waitForLoad(view, 10000));
+    QVERIFY(waitForHostApiReady(hosts[i], 5000));
+    pages[i] = view->page();
+    runJavaScriptSync(pages[i],
+                      "window.__counterEvents = [];"
+                      "window.HostApi.counter.registerEventHandler('valueChanged', function(v) {"
+                      "  window.__counterEvents.push(v);"
+                      "});"
+                      "window.__counterStart = null;"
+                      "window.HostApi.counter.value().then(function(v) {"
+                      "  window.__counterStart = v;"
+                      "});");
+    QTRY_VERIFY(!runJavaScriptSync(pages[i], "window.__counterStart;").isNull());
+  }
+  const int start = runJavaScriptSync(pages[0], "window.__counterStart;").toInt();
+  QCOMPARE(runJavaScriptSync(pages[1], "window.__counterStart;").toInt(), start);
+
+  // One instance backs both pages, and each emission reaches both of them.
+  runJavaScriptSync(pages[0], "window.HostApi.counter.increment();");
+  runJavaScriptSync(pages[1], "window.HostApi.counter.increment();");
+  for (QWebEnginePage *page : pages) {
+    QTRY_COMPARE(runJavaScriptSync(page, "window.__counterEvents.join(',');").toString(),
+                 QStringLiteral("%1,%2").arg(start + 1).arg(start + 2));
+  }
+
+  // A reload detaches the page; the relay stops reaching its bridge until the new page touches
+  // the object again.
+  QObject *secondBridge = nullptr;
+  for (QObject *child : second.findChildren<QObject *>()) {
+    if (qstrcmp(child->metaObject()->className(), "HostBridge") == 0) {
+      secondBridge = child;
+    }
+  }
+  QVERIFY(secondBridge != nullptr);
+  QSignalSpy ready(&second, &WebHost::signalHostApiReady);
+  pages[1]->triggerAction(QWebEnginePage::Reload);
+  QVERIFY(ready.wait(10000));
+  QSignalSpy relayed(secondBridge, SIGNAL(hostApiSignal(QString,QString,QString)));
+  runJavaScriptSync(pages[0], "window.HostApi.counter.increment();");
+  QTRY_COMPARE(runJavaScriptSync(pages[0], "window.__counterEvents.length;").toInt(), 3);
+  QCOMPARE(relayed.count(), 0);
+
+  runJavaScriptSync(pages[1],
+                    "window.__counterEvents = [];"
+                    "window.HostApi.counter.registerEventHandler('valueChanged', function(v) {"
+                    "  window.__counterEvents.push(v);"
+                    "});"
+                    "window.__counterStart = null;"
+                    "window.HostApi.counter.value().then(function(v) {"
+                    "  window.__counterStart = v;"
+                    "});");
+  QTRY_COMPARE(runJavaScriptSync(pages[1], "window.__counterStart;").toInt(), start + 3);
+  runJavaScriptSync(pages[0], "window.HostApi.counter.increment();");
+  QTRY_COMPARE(runJavaScriptSync(pages[1], "window.__counterEvents.join(',');").toString(),
+               QString::number(start + 4));
+  QCOMPARE(relayed.count(), 1);
+}
+
+void WebHostTests::testRpc() {
+  WebHost host;
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  runJavaScriptSync(view->page(),
+                    "window.__rpc = null;"
+                    "var api = window.HostApi.example;"
+                    "Promise.all([api.delayedEcho('later', 100), api.add(2, 3), api.echo('now')])"
+                    "  .then(function(values) { window.__rpc = values.join(','); });");
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__rpc;").toString(),
+               QStringLiteral("later,5,now"));
+
+  runJavaScriptSync(view->page(),
+                    "window.__rpcError = null;"
+                    "window.HostApi.example.delayedEcho('slow', 5000, { timeoutMs: 50 })"
+                    "  .catch(function(err) { window.__rpcError = err.code; });");
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__rpcError;").toString(),
+               QStringLiteral("timeout"));
+
+  runJavaScriptSync(view->page(),
+                    "window.__rpcError = null;"
+                    "var controller = new AbortController();"
+                    "window.HostApi.example.delayedEcho('slow', 5000, { signal: controller.signal })"
+                    "  .catch(function(err) { window.__rpcError = err.code; });"
+                    "controller.abort();");
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__rpcError;").toString(),
+               QStringLiteral("aborted"));
+
+  runJavaScriptSync(view->page(),
+                    "window.__rpcError = null;"
+                    "window.HostApi.example.add(1)"
+                    "  .catch(function(err) { window.__rpcError = err.name + ':' + err.code; });");
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__rpcError;").toString(),
+               QStringLiteral("HostApiError:invalid_arguments"));
+}
+
+void WebHostTests::testRpcArgumentTypes_data() {
+  QTest::addColumn<QString>("call");
+  QTest::addColumn<QString>("expected");
+  QTest::newRow("Exact") << "api.add(2, 3)" << "5";
+  QTest::newRow("Fraction") << "api.add(2.5, 3)" << "invalid_arguments";
+  QTest::newRow("NumericString") << "api.add('2', 3)" << "invalid_arguments";
+  QTest::newRow("Null") << "api.add(null, 3)" << "invalid_arguments";
+  QTest::newRow("OutOfRange") << "api.add(4294967296, 3)" << "invalid_arguments";
+  QTest::newRow("NumberForString") << "api.echo(5)" << "invalid_arguments";
+  QTest::newRow("Threaded") << "api.slowAdd('1', 2, 0)" << "invalid_arguments";
+}
+
+void WebHostTests::testRpcArgumentTypes() {
+  QFETCH(QString, call);
+  QFETCH(QString, expected);
+
+  WebHost host;
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  // A mismatched JSON type is rejected before the method runs instead of being coerced.
+  runJavaScriptSync(view->page(),
+                    "window.__rpc = null;"
+                    "var api = window.HostApi.example;" +
+                        call +
+                        "  .then(function(value) { window.__rpc = String(value); },"
+                        "        function(err) { window.__rpc = err.code; });");
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__rpc;").toString(), expected);
+}
+
+void WebHostTests::testThreadedInvokable() {
+  WebHost host;
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  runJavaScriptSync(view->page(),
+                    "window.__slowSum = null;"
+                    "window.HostApi.example.slowAdd(20, 22, 1500)"
+                    "  .then(function(sum) { window.__slowSum = sum; });");
+
+  // While slowAdd sleeps on a pool thread the GUI thread keeps servicing timers and the page.
+  int ticks = 0;
+  QTimer ticker;
+  connect(&ticker, &QTimer::timeout, this, [&ticks]() { ++ticks; });
+  ticker.start(20);
+
+  QElapsedTimer roundTrip;
+  roundTrip.start();
+  QCOMPARE(runJavaScriptSync(view->page(), "window.__slowSum;").toInt(), 0);
+  QVERIFY(roundTrip.elapsed() < 500);
+
+  QTest::qWait(300);
+  QVERIFY(ticks >= 5);
+
+  QTRY_COMPARE_WITH_TIMEOUT(runJavaScriptSync(view->page(), "window.__slowSum;").toInt(), 42, 5000);
+}
+
+void WebHostTests::testDestroyDuringThreadedCall() {
+  auto host = std::make_unique<WebHost>();
+  host->show();
+
+  auto *view = host->findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(host.get(), 5000));
+
+  runJavaScriptSync(view->page(), "window.HostApi.example.slowAdd(1, 2, 1200);");
+  QTest::qWait(300);
+
+  // The worker is still inside slowAdd; the destructor must wait for it rather than delete the
+  // object it runs on.
+  QElapsedTimer teardown;
+  teardown.start();
+  host.reset();
+  QVERIFY(teardown.elapsed() >= 300);
+
+  // The late result is dropped without touching the destroyed host.
+  QTest::qWait(200);
+}
+
+void WebHostTests::testCborChannelTransport() {
+  WebHost host;
+  host.setChannelTransport(WebHost::ChannelTransport::Cbor);
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  QSignalSpy sendSpy(&host, &WebHost::signalSendData);
+  runJavaScriptSync(view->page(),
+                    "window.HostApi.sendData("
+                    "  { text: 'h\u00e9llo', values: [1, -2, 2.5, null, true] });");
+  QTRY_COMPARE(sendSpy.count(), 1);
+  const QJsonObject sent = sendSpy.at(0).at(0).toJsonValue().toObject();
+  QCOMPARE(sent.value("text").toString(), QStringLiteral("h\u00e9llo"));
+  QCOMPARE(sent.value("values").toArray(), (QJsonArray{1, -2, 2.5, QJsonValue::Null, true}));
+
+  runJavaScriptSync(view->page(),
+                    "window.__cborEvent = null;"
+                    "window.HostApi.addEventListener('actionOne', function(payload) {"
+                    "  window.__cborEvent = payload.label + ':' + payload.value + ':' +"
+                    "      JSON.stringify(payload.values);"
+                    "});");
+  QTRY_VERIFY(host.hasEventSubscribers("actionOne"));
+  host.slotTriggerEvent(
+      "actionOne",
+      QJsonObject{{"label", QStringLiteral("t\u00efck")},
+                  {"value", 42},
+                  {"values", QJsonArray{-2, 2.5, 4294967296.0, QJsonValue::Null, false,
+                                        QJsonObject{{"nested", QJsonArray{}}}}}});
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__cborEvent;").toString(),
+               QStringLiteral("t\u00efck:42:[-2,2.5,4294967296,null,false,{\"nested\":[]}]"));
+
+  runJavaScriptSync(view->page(),
+                    "window.__rpc = null;"
+                    "window.HostApi.example.add(2, 3).then(function(v) { window.__rpc = v; });");
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__rpc;").toInt(), 5);
+}
+
+void WebHostTests::testBlobDownload() {
+  WebHost host;
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  QByteArray data(4 * 1024 * 1024, Qt::Uninitialized);
+  for (int i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(i % 251);
+  }
+  QSignalSpy releasedSpy(&host, &WebHost::signalBlobReleased);
+  const QString id = host.publishBlob(data);
+  QVERIFY(!id.isEmpty());
+
+  const QString readScript = QStringLiteral(
+      "window.__blob = null;"
+      "window.HostApi.fetchBlob('%1').then(function(buffer) {"
+      "  var bytes = new Uint8Array(buffer);"
+      "  var sum = 0;"
+      "  for (var i = 0; i < bytes.length; i++) { sum = (sum + bytes[i] * (i % 7 + 1)) % 65521; }"
+      "  window.__blob = bytes.length + ':' + sum;"
+      "}, function(err) { window.__blob = 'error'; });");
+  quint32 sum = 0;
+  for (int i = 0; i < data.size(); ++i) {
+    sum = (sum + static_cast<quint8>(data[i]) * (i % 7 + 1)) % 65521;
+  }
+
+  runJavaScriptSync(view->page(), readScript.arg(id));
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__blob;").toString(),
+               QStringLiteral("%1:%2").arg(data.size()).arg(sum));
+  QCOMPARE(releasedSpy.count(), 1);
+
+  // Released after the first read.
+  runJavaScriptSync(view->page(), readScript.arg(id));
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__blob;").toString(),
+               QStringLiteral("error"));
+
+  auto *device = new QBuffer;
+  device->setData("streamed");
+  const QString deviceId = host.publishBlob(device, QStringLiteral("text/plain"));
+  runJavaScriptSync(view->page(),
+                    QStringLiteral("window.__blob = null;"
+                                   "window.HostApi.fetchBlob('%1').then(function(buffer) {"
+                                   "  window.__blob = new TextDecoder().decode(buffer);"
+                                   "});")
+                        .arg(deviceId));
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__blob;").toString(),
+               QStringLiteral("streamed"));
+
+  const QString persistentId =
+      host.publishBlob(QByteArray("kept"), QStringLiteral("text/plain"),
+                       WebHost::BlobLifetime::Persistent);
+  QVERIFY(host.releaseBlob(persistentId));
+  QVERIFY(!host.releaseBlob(persistentId));
+}
+
+void WebHostTests::testUploadStreaming() {
+  WebHost host;
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  constexpr int kUploadBytes = 8 * 1024 * 1024;
+  QByteArray received;
+  int chunkCount = 0;
+  connect(&host, &WebHost::signalUploadChunk, this, [&](QString, QByteArray chunk) {
+    received.append(chunk);
+    ++chunkCount;
+  });
+  QSignalSpy finishedSpy(&host, &WebHost::signalUploadFinished);
+
+  runJavaScriptSync(view->page(),
+                    QStringLiteral("window.__upload = null;"
+                                   "var data = new Uint8Array(%1);"
+                                   "for (var i = 0; i < data.length; i++) { data[i] = i % 253; }"
+                                   "window.HostApi.upload('capture', data).then(function(result) {"
+                                   "  window.__upload = result.size;"
+                                   "});")
+                        .arg(kUploadBytes));
+  QTRY_COMPARE_WITH_TIMEOUT(runJavaScriptSync(view->page(), "window.__upload;").toInt(),
+                            kUploadBytes, 30000);
+  QCOMPARE(finishedSpy.count(), 1);
+  QCOMPARE(finishedSpy.at(0).at(1).toString(), QStringLiteral("capture"));
+  QCOMPARE(finishedSpy.at(0).at(2).toLongLong(), qint64(kUploadBytes));
+  QVERIFY(finishedSpy.at(0).at(3).toBool());
+  QCOMPARE(received.size(), kUploadBytes);
+  QVERIFY(chunkCount > 1);
+  QCOMPARE(static_cast<quint8>(received.at(kUploadBytes - 1)), quint8((kUploadBytes - 1) % 253));
+
+  QBuffer sink;
+  sink.open(QIODevice::WriteOnly);
+  host.setUploadSink("recording", &sink);
+  const int chunksBefore = chunkCount;
+  runJavaScriptSync(view->page(),
+                    "window.__upload = null;"
+                    "var blob = new Blob(['sink data'], { type: 'audio/webm' });"
+                    "window.HostApi.upload('recording', blob).then(function(result) {"
+                    "  window.__upload = result.size;"
+                    "});");
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__upload;").toInt(), 9);
+  QCOMPARE(sink.data(), QByteArray("sink data"));
+  QCOMPARE(chunkCount, chunksBefore);
+
+  // A sink destroyed mid-upload fails the upload rather than diverting the rest to chunkReceived.
+  auto *doomed = new QBuffer;
+  doomed->open(QIODevice::WriteOnly);
+  connect(doomed, &QIODevice::bytesWritten, doomed, &QObject::deleteLater);
+  host.setUploadSink("doomed", doomed);
+  finishedSpy.clear();
+  runJavaScriptSync(view->page(),
+                    QStringLiteral("window.__upload = null;"
+                                   "window.HostApi.upload('doomed', new Uint8Array(%1))"
+                                   "  .then(function() { window.__upload = 'ok'; },"
+                                   "        function() { window.__upload = 'failed'; });")
+                        .arg(kUploadBytes));
+  QTRY_COMPARE_WITH_TIMEOUT(runJavaScriptSync(view->page(), "window.__upload;").toString(),
+                            QStringLiteral("failed"), 30000);
+  QCOMPARE(finishedSpy.count(), 1);
+  QVERIFY(!finishedSpy.at(0).at(3).toBool());
+  QCOMPARE(chunkCount, chunksBefore);
+}
+
+void WebHostTests::testStreamBackpressure() {
+  WebHost host;
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  constexpr int kChunkBytes = 16 * 1024;
+  const QString id = host.openStream(64 * 1024);
+  runJavaScriptSync(view->page(),
+                    QStringLiteral("window.__streamBytes = 0;"
+                                   "window.__streamDone = false;"
+                                   "window.__stream = window.HostApi.openStream('%1', {"
+                                   "  highWaterMark: 32768"
+                                   "});")
+                        .arg(id));
+
+  // Nothing reads the stream yet, so the page stops pulling at its own high-water mark and the
+  // host queue fills up.
+  const QByteArray chunk(kChunkBytes, 's');
+  int written = 0;
+  bool blocked = false;
+  while (written < 64 && !blocked) {
+    blocked = !host.writeStream(id, chunk);
+    ++written;
+    QTest::qWait(10);
+  }
+  QVERIFY(blocked);
+  QVERIFY(!host.isStreamWritable(id));
+  QVERIFY(written * kChunkBytes < 64 * 1024 + 32 * 1024 + 2 * kChunkBytes);
+
+  QSignalSpy writableSpy(&host, &WebHost::signalStreamWritable);
+  runJavaScriptSync(view->page(),
+                    "var reader = window.__stream.getReader();"
+                    "(function next() {"
+                    "  reader.read().then(function(result) {"
+                    "    if (result.done) { window.__streamDone = true; return; }"
+                    "    window.__streamBytes += result.value.byteLength;"
+                    "    next();"
+                    "  });"
+                    "})();");
+  QVERIFY(writableSpy.count() > 0 || writableSpy.wait(5000));
+  QVERIFY(host.writeStream(id, chunk));
+  ++written;
+  host.closeStream(id);
+
+  QTRY_VERIFY(runJavaScriptSync(view->page(), "window.__streamDone;").toBool());
+  QCOMPARE(runJavaScriptSync(view->page(), "window.__streamBytes;").toInt(),
+           written * kChunkBytes);
+}
+
+void WebHostTests::testSchemeRoot_data() {
+  QTest::addColumn<bool>("fromQrc");
+  QTest::newRow("Directory") << false;
+  QTest::newRow("Qrc") << true;
+}
+
+void WebHostTests::testSchemeRoot() {
+  QFETCH(bool, fromQrc);
+
+  WebHost host;
+  host.setRootScheme(fromQrc ? WebHost::AssetSource::Qrc : WebHost::AssetSource::Directory);
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+  QVERIFY(view->page()->url().toString().startsWith("webhost://app/"));
+
+  runJavaScriptSync(view->page(),
+                    "window.__asset = null;"
+                    "fetch('main.js').then(function(response) {"
+                    "  window.__asset = response.headers.get('Content-Type') + '|' +"
+                    "      response.headers.get('ETag') + '|' +"
+                    "      response.headers.get('Cache-Control');"
+                    "});");
+  QTRY_VERIFY(!runJavaScriptSync(view->page(), "window.__asset;").isNull());
+  const QStringList parts =
+      runJavaScriptSync(view->page(), "window.__asset;").toString().split('|');
+  QCOMPARE(parts.size(), 3);
+  QVERIFY(parts.at(0).contains("javascript"));
+  QVERIFY(parts.at(1).startsWith('"'));
+  QCOMPARE(parts.at(2), QStringLiteral("no-cache"));
+}
+
+void WebHostTests::testSchemeRootFollowsDisk() {
+  QTemporaryDir root;
+  QVERIFY(root.isValid());
+  for (const QString &name : QDir("web").entryList(QDir::Files)) {
+    QVERIFY(QFile::copy(QDir("web").filePath(name), root.filePath(name)));
+  }
+  auto writeFile = [&](const QString &name, const QByteArray &text) {
+    QFile file(root.filePath(name));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(text);
+  };
+  writeFile("note.txt", "one");
+
+  WebHost host(root.path());
+  host.setRootScheme(WebHost::AssetSource::Directory);
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  // Each call starts a fetch and returns what the previous one for the same name read.
+  runJavaScriptSync(view->page(),
+                    "window.__reads = {};"
+                    "window.__read = function(name) {"
+                    "  fetch(name, { cache: 'no-store' })"
+                    "    .then(function(response) { return response.text(); })"
+                    "    .then(function(text) { window.__reads[name] = text; },"
+                    "          function() { window.__reads[name] = 'missing'; });"
+                    "  return window.__reads[name] || null;"
+                    "};");
+  auto read = [&](const char *name) {
+    return runJavaScriptSync(view->page(), QStringLiteral("window.__read('%1');").arg(name))
+        .toString();
+  };
+  QTRY_COMPARE(read("note.txt"), QStringLiteral("one"));
+  QTRY_COMPARE(read("fresh.txt"), QStringLiteral("missing"));
+
+  // An in-place write and a new file both reach the cache without a reload.
+  writeFile("note.txt", "two");
+  writeFile("fresh.txt", "new");
+  QTRY_COMPARE(read("note.txt"), QStringLiteral("two"));
+  QTRY_COMPARE(read("fresh.txt"), QStringLiteral("new"));
+}
+
+void WebHostTests::testPackRoot() {
+  WebHost host;
+  QVERIFY(!host.setRootPack("missing.whpack"));
+  QVERIFY(host.setRootPack("web.whpack"));
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+  QVERIFY(view->page()->url().toString().startsWith("webhost://app/"));
+
+  QFile index("web/index.html");
+  QVERIFY(index.open(QIODevice::ReadOnly));
+  runJavaScriptSync(view->page(),
+                    "window.__asset = null;"
+                    "fetch('index.html').then(function(response) { return response.text(); })"
+                    "  .then(function(text) { window.__asset = text; });");
+  QTRY_VERIFY(!runJavaScriptSync(view->page(), "window.__asset;").isNull());
+  QCOMPARE(runJavaScriptSync(view->page(), "window.__asset;").toString(),
+           QString::fromUtf8(index.readAll()));
+}
+
+void WebHostTests::testFileRequestCache() {
+  WebHost host;
+  host.setRootDir("web");
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  const WebHost::FileRequestStats firstLoad = host.fileRequestStats();
+  QVERIFY(firstLoad.requests > 0);
+
+  host.resetFileRequestStats();
+  view->page()->triggerAction(QWebEnginePage::Reload);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+
+  // The reload requests the same files, so every decision comes from the cache.
+  const WebHost::FileRequestStats reload = host.fileRequestStats();
+  QVERIFY(reload.requests > 0);
+  QCOMPARE(reload.cacheHits, reload.requests);
+  qInfo() << "File interceptor:" << reload.requests << "requests,"
+          << (reload.totalNanoseconds / reload.requests) << "ns/request on reload";
+
+  runJavaScriptSync(view->page(), "new Image().src = '../outside-root.png';");
+  QTRY_VERIFY(host.fileRequestStats().blocked > 0);
+}
+
+void WebHostTests::testHotReload() {
+  QTemporaryDir root;
+  QVERIFY(root.isValid());
+  for (const QString &name : QDir("web").entryList(QDir::Files)) {
+    QVERIFY(QFile::copy(QDir("web").filePath(name), root.filePath(name)));
+  }
+
+  WebHost host;
+  host.setRootDir(root.path());
+  host.setHotReloadEnabled(true);
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForLoad(view, 10000));
+  QVERIFY(waitForHostApiReady(&host, 5000));
+  runJavaScriptSync(view->page(), "window.__hotMarker = 1;");
+
+  auto appendTo = [&](const QString &name, const QByteArray &text) {
+    QFile file(root.filePath(name));
+    QVERIFY(file.open(QIODevice::Append));
+    file.write(text);
+  };
+
+  // A stylesheet change swaps the <link> without reloading the page.
+  QSignalSpy hotReloadSpy(&host, &WebHost::signalHotReload);
+  appendTo("styles.css", "\nbody { outline: 0; }\n");
+  QVERIFY(hotReloadSpy.wait(5000));
+  QCOMPARE(hotReloadSpy.at(0).at(0).toStringList(), QStringList{"styles.css"});
+  QTRY_VERIFY(runJavaScriptSync(view->page(),
+                                "document.querySelector(\"link[href*='hot=']\") !== null")
+                  .toBool());
+  QCOMPARE(runJavaScriptSync(view->page(), "window.__hotMarker;").toInt(), 1);
+
+  // A page handler that applies the change itself keeps the page.
+  runJavaScriptSync(view->page(),
+                    "window.__hotPaths = null;"
+                    "window.HostApi.setHotReloadHandler(function(paths) {"
+                    "  window.__hotPaths = paths.join(',');"
+                    "  return true;"
+                    "});");
+  appendTo("main.js", "\n// handled\n");
+  QTRY_COMPARE(runJavaScriptSync(view->page(), "window.__hotPaths;").toString(),
+               QStringLiteral("main.js"));
+  QCOMPARE(runJavaScriptSync(view->page(), "window.__hotMarker;").toInt(), 1);
+
+  // Without a handler a loaded module cannot be swapped, so the page reloads.
+  runJavaScriptSync(view->page(), "window.HostApi.setHotReloadHandler(null);");
+  appendTo("main.js", "\n// edited\n");
+  QTRY_VERIFY_WITH_TIMEOUT(
+      runJavaScriptSync(view->page(), "window.__hotMarker === undefined && !!window.HostApi")
+          .toBool(),
+      10000);
+}
+
+void WebHostTests::testWebHostPool() {
+  WebHostPool pool;
+  pool.setSize(2);
+  QTRY_COMPARE_WITH_TIMEOUT(pool.readyCount(), 2, 20000);
+
+  QElapsedTimer timer;
+  timer.start();
+  std::unique_ptr<WebHost> host(pool.acquire());
+  host->show();
+  auto *view = host->findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(!view->page()->isLoading());
+  QVERIFY(waitForHostApiReady(host.get(), 5000));
+  qInfo() << "Pooled host ready in" << timer.elapsed() << "ms";
+
+  QCOMPARE(pool.readyCount(), 1);
+  QTRY_COMPARE_WITH_TIMEOUT(pool.readyCount(), 2, 20000);
+
+  pool.setIdleTimeout(100);
+  QTRY_COMPARE(pool.readyCount(), 0);
+  QCOMPARE(pool.warmingCount(), 0);
+}
+
+void WebHostTests::testWebHostPoolFailedWarmup() {
+  // An existing directory without index.html: every load fails.
+  QTemporaryDir emptyRoot;
+  QVERIFY(emptyRoot.isValid());
+  int created = 0;
+  WebHostPool pool([&]() {
+    ++created;
+    return new WebHost(emptyRoot.path());
+  });
+  QSignalSpy failedSpy(&pool, &WebHostPool::signalHostFailed);
+  pool.setWarmupTimeout(3000);
+  pool.setSize(1);
+
+  // Failed hosts are deleted and retried with backoff instead of blocking the slot forever.
+  QTRY_VERIFY_WITH_TIMEOUT(failedSpy.count() >= 2, 20000);
+  QCOMPARE(pool.readyCount(), 0);
+  QVERIFY(pool.warmingCount() <= 1);
+  QVERIFY(created <= failedSpy.count() + 1);
+}
+
+void WebHostTests::testWebHostPoolDestroyedAfterAcquire() {
+  constexpr int kWarmupTimeoutMs = 10000;
+  QElapsedTimer sinceWarmup;
+  sinceWarmup.start();
+  auto pool = std::make_unique<WebHostPool>();
+  pool->setWarmupTimeout(kWarmupTimeoutMs);
+  QTRY_COMPARE_WITH_TIMEOUT(pool->readyCount(), 1, kWarmupTimeoutMs);
+  std::unique_ptr<WebHost> host(pool->acquire());
+  QSignalSpy failedSpy(pool.get(), &WebHostPool::signalHostFailed);
+  QCOMPARE(failedSpy.count(), 0);
+
+  // The warm-up timer of the acquired host must die with the pool rather than fire into it.
+  pool.reset();
+  QTest::qWait(int(qMax<qint64>(0, kWarmupTimeoutMs - sinceWarmup.elapsed())) + 500);
+  QVERIFY(host->isHostApiReady());
+}
+
+void WebHostTests::testSharedProfile_data() {
+  QTest::addColumn<bool>("sharedProfile");
+  QTest::newRow("PerInstance") << false;
+  QTest::newRow("Shared") << true;
+}
+
+void WebHostTests::testSharedProfile() {
+  QFETCH(bool, sharedProfile);
+  WebHost::setDefaultProfileMode(sharedProfile ? WebHost::ProfileMode::Shared
+                                               : WebHost::ProfileMode::PerInstance);
+  WebHost first;
+  WebHost second;
+  WebHost::setDefaultProfileMode(WebHost::ProfileMode::PerInstance);
+  QCOMPARE(second.profileMode() == WebHost::ProfileMode::Shared, sharedProfile);
+
+  QWebEnginePage *pages[2] = {};
+  WebHost *hosts[2] = {&first, &second};
+  for (int i = 0; i < 2; ++i) {
+    hosts[i]->show();
+    auto *view = hosts[i]->findChild<QWebEngineView *>();
+    QVERIFY(view != nullptr);
+    QVERIFY(waitForLoad(view, 10000));
+    QVERIFY(waitForHostApiReady(hosts[i], 5000));
+    pages[i] = view->page();
+  }
+  QCOMPARE(pages[0]->profile() == pages[1]->profile(), sharedProfile);
+
+  // Both hosts route through the same scheme handler when shared; each upload must still reach
+  // the host whose page sent it.
+  QSignalSpy firstSpy(&first, &WebHost::signalUploadFinished);
+  QSignalSpy secondSpy(&second, &WebHost::signalUploadFinished);
+  for (int i = 0; i < 2; ++i) {
+    runJavaScriptSync(pages[i],
+                      QStringLiteral("window.__upload = null;"
+                                     "window.HostApi.upload('panel', new Uint8Array(%1))"
+                                     "  .then(function(result) { window.__upload = result.size; });")
+                          .arg(100 + i));
+    QTRY_COMPARE(runJavaScriptSync(pages[i], "window.__upload;").toInt(), 100 + i);
+  }
+  QCOMPARE(firstSpy.count(), 1);
+  QCOMPARE(firstSpy.at(0).at(2).toLongLong(), qint64(100));
+  QCOMPARE(secondSpy.count(), 1);
+  QCOMPARE(secondSpy.at(0).at(2).toLongLong(), qint64(101));
+
+  // Each page keeps its own root confinement and counters.
+  first.resetFileRequestStats();
+  second.resetFileRequestStats();
+  runJavaScriptSync(pages[0], "new Image().src = '../outside-root.png';");
+  QTRY_COMPARE(first.fileRequestStats().blocked, quint64(1));
+  QCOMPARE(second.fileRequestStats().requests, quint64(0));
+}
+
+void WebHostTests::testBootstrapStartupLatency_data() {
+  QTest::addColumn<bool>("documentCreation");
+  QTest::newRow("LoadFinished") << false;
+  QTest::newRow("DocumentCreation") << true;
+}
+
+void WebHostTests::testBootstrapStartupLatency() {
+  QFETCH(bool, documentCreation);
+
+  // Set before construction so the timed load is the host's first and only one.
+  WebHost::setDefaultBootstrapMode(documentCreation ? WebHost::BootstrapMode::DocumentCreation
+                                                    : WebHost::BootstrapMode::LoadFinished);
+  const auto restoreMode = qScopeGuard(
+      []() { WebHost::setDefaultBootstrapMode(WebHost::BootstrapMode::DocumentCreation); });
+
+  QElapsedTimer timer;
+  timer.start();
+
+  WebHost host;
+  QCOMPARE(host.bootstrapMode(), documentCreation ? WebHost::BootstrapMode::DocumentCreation
+                                                  : WebHost::BootstrapMode::LoadFinished);
+  host.show();
+
+  auto *view = host.findChild<QWebEngineView *>();
+  QVERIFY(view != nullptr);
+  QVERIFY(waitForHostApiReady(&host, 10000));
+  const qint64 readyMs = timer.elapsed();
+
+  qInfo() << "HostApi bootstrap" << QTest::currentDataTag()
+          << "construction-to-HostApiReady:" << readyMs << "ms";
+
+  QVariant version = runJavaScriptSync(view->page(), "window.HostApi.version;");
+  QCOMPARE(version.toString(), hostApiVersion());
 }
 
 int main(int argc, char **argv) {
-  qputenv("QT_QPA_PLATFORM", "offscreen");
-  qputenv("QTWEBENGINE_CHROMIUM_FLAGS",
-          "--no-sandbox --disable-setuid-sandbox --disable-gpu --headless "
-          "--disable-software-rasterizer --disable-dev-shm-usage");
-  qputenv("QTWEBENGINE_DISABLE_SANDBOX", "1");
-  QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+  configureHeadlessWebEngine();
   WebHost::registerUrlScheme();
 
   QApplication app(argc, argv);
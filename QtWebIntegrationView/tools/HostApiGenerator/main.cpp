@@ -1,5 +1,6 @@
 #include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
 #include <QJsonArray>
@@ -28,8 +29,13 @@ struct ParamInfo {
 struct MethodInfo {
   QString name;
   QString qtReturn;
+  QString qtValue;
   QString tsReturn;
   bool returnsVoid = false;
+  bool returnsFuture = false;
+  bool threaded = false;
+  // Position in the generated invokeHostApiMethodIndex switch, unique across all classes.
+  int dispatchIndex = -1;
   QList<ParamInfo> params;
 };
 
@@ -41,6 +47,8 @@ struct SignalInfo {
 struct ClassInfo {
   QString name;
   QString cppName;
+  bool eager = false;
+  bool shared = false;
   QList<MethodInfo> methods;
   QList<SignalInfo> signalInfos;
 };
@@ -196,6 +204,17 @@ bool isClassExposed(const QMetaObject *meta) {
   return false;
 }
 
+QStringList classInfoValues(const QMetaObject *meta, const QString &name) {
+  QStringList values;
+  for (int i = 0; i < meta->classInfoCount(); ++i) {
+    const QMetaClassInfo info = meta->classInfo(i);
+    if (QString::fromLatin1(info.name()) == name) {
+      values.append(QString::fromLatin1(info.value()));
+    }
+  }
+  return values;
+}
+
 QString classExportName(const QMetaObject *meta, const QString &fallback) {
   for (int i = 0; i < meta->classInfoCount(); ++i) {
     const QMetaClassInfo info = meta->classInfo(i);
@@ -210,7 +229,15 @@ ClassInfo buildClassInfo(const QMetaObject *meta, const QString &exportName, QSt
   ClassInfo info;
   info.name = exportName;
   info.cppName = QString::fromLatin1(meta->className());
-
+  info.eager = classInfoValues(meta, QStringLiteral("HostApi.Eager")).contains("true");
+  info.shared = classInfoValues(meta, QStringLiteral("HostApi.Shared")).contains("true");
+  const bool classThreaded = classInfoValues(meta, QStringLiteral("HostApi.Threaded")).contains("true");
+  const QStringList threadedMethods = classInfoValues(meta, QStringLiteral("HostApi.ThreadedMethod"));
+
+  // JS wrappers are keyed by method name, so a second public method with the same name would
+  // silently replace the first. moc lists a method with default arguments once per arity; the
+  // full signature comes first and covers the clones.
+  QSet<QString> methodNames;
   const int methodStart = meta->methodOffset();
   const int methodEnd = meta->methodCount();
   for (int i = methodStart; i < methodEnd; ++i) {
@@ -257,13 +284,37 @@ ClassInfo buildClassInfo(const QMetaObject *meta, const QString &exportName, QSt
       continue;
     }
 
+    if (methodNames.contains(methodName)) {
+      if (warnings && !(method.attributes() & QMetaMethod::Cloned)) {
+        warnings->append(QStringLiteral("Overloaded method %1::%2 is not exposed; HostApi methods "
+                                        "are keyed by name in JS")
+                             .arg(info.cppName, methodName));
+      }
+      continue;
+    }
+
     const int returnTypeId = method.returnType();
     QString returnType = QString::fromLatin1(QMetaType(returnTypeId).name());
+    if (returnType.isEmpty()) {
+      returnType = QString::fromLatin1(method.typeName());
+    }
     if (returnType.isEmpty()) {
       returnType = QStringLiteral("void");
     }
+
+    // QFuture<T> invokables complete asynchronously; JS sees them as Promise<T>.
+    QString valueType = returnType;
+    bool returnsFuture = false;
+    if (normalizeType(returnType).startsWith("QFuture<")) {
+      QStringList futureArgs;
+      if (splitTemplateArgs(normalizeType(returnType), &futureArgs) && futureArgs.size() == 1) {
+        valueType = futureArgs[0];
+        returnsFuture = true;
+      }
+    }
+
     QString tsReturn;
-    if (!mapTypeToTs(returnType, &tsReturn)) {
+    if (!mapTypeToTs(valueType, &tsReturn)) {
       supported = false;
       if (warnings) {
         warnings->append(QStringLiteral("Unsupported return type %1 on %2::%3")
@@ -278,10 +329,14 @@ ClassInfo buildClassInfo(const QMetaObject *meta, const QString &exportName, QSt
     MethodInfo methodInfo;
     methodInfo.name = methodName;
     methodInfo.qtReturn = returnType;
+    methodInfo.qtValue = normalizeType(valueType);
     methodInfo.tsReturn = tsReturn;
     methodInfo.returnsVoid = (tsReturn == "void");
+    methodInfo.returnsFuture = returnsFuture;
+    methodInfo.threaded = !returnsFuture && (classThreaded || threadedMethods.contains(methodName));
     methodInfo.params = params;
     info.methods.append(methodInfo);
+    methodNames.insert(methodName);
   }
 
   return info;
@@ -291,6 +346,8 @@ QJsonObject toJson(const ClassInfo &info) {
   QJsonObject obj;
   obj.insert(QStringLiteral("name"), info.name);
   obj.insert(QStringLiteral("cppName"), info.cppName);
+  obj.insert(QStringLiteral("eager"), info.eager);
+  obj.insert(QStringLiteral("shared"), info.shared);
 
   QJsonArray methods;
   for (const auto &method : info.methods) {
@@ -299,6 +356,8 @@ QJsonObject toJson(const ClassInfo &info) {
     methodObj.insert(QStringLiteral("returnType"), method.qtReturn);
     methodObj.insert(QStringLiteral("tsReturn"), method.tsReturn);
     methodObj.insert(QStringLiteral("returnsVoid"), method.returnsVoid);
+    methodObj.insert(QStringLiteral("returnsFuture"), method.returnsFuture);
+    methodObj.insert(QStringLiteral("threaded"), method.threaded);
     QJsonArray params;
     for (const auto &param : method.params) {
       QJsonObject paramObj;
@@ -341,32 +400,562 @@ bool writeFile(const QString &path, const QString &content) {
   return true;
 }
 
+// HostApiEvent values are positions in hostApiEventTypes(), which is also the id the page
+// receives and the index of its listener array.
+QString generateEventHeader(const QStringList &eventTypes) {
+  QString text;
+  text += "#pragma once\n\n";
+  text += "#include <QString>\n\n";
+  text += "enum class HostApiEvent : int {\n";
+  for (int i = 0; i < eventTypes.size(); ++i) {
+    text += "  " + toPascalCase(eventTypes[i]) + " = " + QString::number(i) + ",\n";
+  }
+  text += "};\n\n";
+  text += "constexpr int kHostApiEventCount = " + QString::number(eventTypes.size()) + ";\n\n";
+  text += "QString hostApiEventName(HostApiEvent event);\n";
+  text += "// Id of eventType, or -1 if it is not a HostApi event type.\n";
+  text += "int hostApiEventId(const QString &eventType);\n";
+  return text;
+}
+
 QString generateCppHeader() {
   QString text;
   text += "#pragma once\n\n";
+  text += "#include <QByteArray>\n";
+  text += "#include <QJsonArray>\n";
   text += "#include <QJsonObject>\n";
+  text += "#include <QJsonValue>\n";
   text += "#include <QList>\n";
   text += "#include <QObject>\n";
   text += "#include <QString>\n\n";
+  text += "#include <functional>\n\n";
   text += "class QWebChannel;\n\n";
   text += "struct HostApiObjectInfo {\n";
   text += "  QString name;\n";
   text += "  QObject *instance = nullptr;\n";
+  text += "  // Set for classes without HOSTAPI_EAGER; builds instance on first use.\n";
+  text += "  std::function<QObject *(QObject *owner)> create;\n";
+  text += "  // HOSTAPI_SHARED: instance is process-wide and its signals go through relayHostApiSignals.\n";
+  text += "  bool shared = false;\n";
+  text += "};\n\n";
+  text += "struct HostApiRpcResult {\n";
+  text += "  bool ok = true;\n";
+  text += "  QJsonValue value;\n";
+  text += "  QString errorCode;\n";
+  text += "  QString errorMessage;\n";
   text += "};\n\n";
+  text += "using HostApiRpcCallback = std::function<void(const HostApiRpcResult &)>;\n";
+  text += "using HostApiRpcCancel = std::function<void()>;\n";
+  text += "using HostApiSignalRelay = std::function<void(const QString &signal, const QJsonArray &args)>;\n\n";
+  text += "// Constructs HOSTAPI_EAGER classes and registers them on channel as HostApi_<name>; the\n";
+  text += "// others are returned with a factory and no instance.\n";
   text += "QList<HostApiObjectInfo> registerHostApiObjects(QWebChannel *channel, QObject *parent);\n";
   text += "QJsonObject hostApiSchema();\n";
+  text += "// Compact JSON text of hostApiSchema() and the first 16 hex digits of its SHA-256.\n";
+  text += "QByteArray hostApiSchemaJson();\n";
+  text += "QString hostApiSchemaHash();\n";
+  text += "// Minified JS object literal of per-class wrapper factories for the WebHost bootstrap.\n";
+  text += "QString hostApiWrapperScript();\n\n";
+  text += "// Connects every signal of a shared object to relay, with its arguments converted to JSON.\n";
+  text += "void relayHostApiSignals(const QString &objectName, QObject *instance,\n";
+  text += "                         const HostApiSignalRelay &relay);\n\n";
+  text += "// Blocks until no threaded call runs on any of objects. Owners call it before deleting them.\n";
+  text += "void waitForHostApiCalls(const QList<HostApiObjectInfo> &objects);\n\n";
+  text += "// Calls method on object with JSON arguments. done runs exactly once, later for QFuture\n";
+  text += "// methods; the returned function (empty for synchronous calls) cancels a pending call.\n";
+  text += "HostApiRpcCancel invokeHostApiMethod(const HostApiObjectInfo &object, const QString &method,\n";
+  text += "                                     const QJsonArray &args, const HostApiRpcCallback &done);\n\n";
+  text += "// Index of method with argCount parameters on objectName in the generated dispatch table, or\n";
+  text += "// -1. The JS wrappers carry the same indices.\n";
+  text += "int hostApiMethodIndex(const QString &objectName, const QString &method, int argCount);\n";
+  text += "// invokeHostApiMethod for a method resolved by hostApiMethodIndex: one switch, with arguments\n";
+  text += "// unpacked straight into their C++ types.\n";
+  text += "HostApiRpcCancel invokeHostApiMethodIndex(const HostApiObjectInfo &object, int methodIndex,\n";
+  text += "                                          const QJsonArray &args,\n";
+  text += "                                          const HostApiRpcCallback &done);\n";
   return text;
 }
 
+const char kCppRpcHelpers[] = R"CPP(namespace {
+
+HostApiRpcResult hostApiRpcValue(const QJsonValue &value = QJsonValue::Null) {
+  HostApiRpcResult result;
+  result.value = value;
+  return result;
+}
+
+HostApiRpcResult hostApiRpcError(const QString &code, const QString &message) {
+  HostApiRpcResult result;
+  result.ok = false;
+  result.errorCode = code;
+  result.errorMessage = message;
+  return result;
+}
+
+// Thrown by hostApiArg when a JSON argument does not have the parameter's type; the invokers
+// turn it into an invalid_arguments rejection.
+struct HostApiArgumentError {
+  QString message;
+};
+
+template <typename T>
+[[noreturn]] void hostApiArgMismatch(int index, const QJsonValue &value) {
+  static const char *const jsonTypes[] = {"null", "boolean", "number", "string", "array", "object"};
+  const int type = value.isUndefined() ? 0 : int(value.type());
+  throw HostApiArgumentError{QStringLiteral("Argument %1 must be %2, got %3.")
+                                 .arg(index)
+                                 .arg(QString::fromLatin1(QMetaType::fromType<T>().name()))
+                                 .arg(QString::fromLatin1(jsonTypes[qMin(type, 5)]))};
+}
+
+// Converts args[index] to T. JSON scalars must match the parameter type exactly: numbers are
+// not rounded into integers and strings are not parsed into numbers.
+template <typename T>
+T hostApiArg(const QJsonArray &args, int index) {
+  const QJsonValue value = args.at(index);
+  if constexpr (std::is_same_v<T, QJsonValue>) {
+    return value;
+  } else if constexpr (std::is_same_v<T, QJsonObject>) {
+    if (!value.isObject()) {
+      hostApiArgMismatch<T>(index, value);
+    }
+    return value.toObject();
+  } else if constexpr (std::is_same_v<T, QJsonArray>) {
+    if (!value.isArray()) {
+      hostApiArgMismatch<T>(index, value);
+    }
+    return value.toArray();
+  } else if constexpr (std::is_same_v<T, QString>) {
+    if (!value.isString()) {
+      hostApiArgMismatch<T>(index, value);
+    }
+    return value.toString();
+  } else if constexpr (std::is_same_v<T, bool>) {
+    if (!value.isBool()) {
+      hostApiArgMismatch<T>(index, value);
+    }
+    return value.toBool();
+  } else if constexpr (std::is_integral_v<T>) {
+    const double number = value.toDouble();
+    const double limit = std::ldexp(1.0, std::numeric_limits<T>::digits);
+    if (!value.isDouble() || std::trunc(number) != number ||
+        number < double(std::numeric_limits<T>::lowest()) || number >= limit) {
+      hostApiArgMismatch<T>(index, value);
+    }
+    return static_cast<T>(number);
+  } else if constexpr (std::is_floating_point_v<T>) {
+    if (!value.isDouble()) {
+      hostApiArgMismatch<T>(index, value);
+    }
+    return static_cast<T>(value.toDouble());
+  } else if constexpr (std::is_same_v<T, QVariant>) {
+    return value.toVariant();
+  } else {
+    // Containers and other metatypes go through QVariant, which must know the conversion.
+    const QVariant variant = value.toVariant();
+    if (!variant.canConvert<T>()) {
+      hostApiArgMismatch<T>(index, value);
+    }
+    return qvariant_cast<T>(variant);
+  }
+}
+
+template <typename T>
+QJsonValue hostApiToJson(const T &value) {
+  if constexpr (std::is_convertible_v<T, QJsonValue>) {
+    return QJsonValue(value);
+  } else {
+    return QJsonValue::fromVariant(QVariant::fromValue(value));
+  }
+}
+
+template <typename T>
+HostApiRpcCancel hostApiRpcFuture(const QFuture<T> &future, QObject *context,
+                                  const HostApiRpcCallback &done) {
+  auto *watcher = new QFutureWatcher<T>(context);
+  QObject::connect(watcher, &QFutureWatcherBase::finished, context, [watcher, done]() {
+    watcher->deleteLater();
+    const QFuture<T> finished = watcher->future();
+    try {
+      finished.waitForFinished();
+      if (finished.isCanceled()) {
+        done(hostApiRpcError(QStringLiteral("cancelled"), QStringLiteral("The call was cancelled.")));
+        return;
+      }
+      if constexpr (std::is_void_v<T>) {
+        done(hostApiRpcValue());
+      } else if (finished.resultCount() == 0) {
+        done(hostApiRpcError(QStringLiteral("no_result"), QStringLiteral("The call produced no result.")));
+      } else {
+        done(hostApiRpcValue(hostApiToJson(finished.result())));
+      }
+    } catch (const std::exception &error) {
+      done(hostApiRpcError(QStringLiteral("failed"), QString::fromUtf8(error.what())));
+    } catch (...) {
+      done(hostApiRpcError(QStringLiteral("failed"), QStringLiteral("The call failed.")));
+    }
+  });
+  watcher->setFuture(future);
+  const QPointer<QFutureWatcher<T>> guard(watcher);
+  return [guard]() {
+    if (guard) {
+      guard->cancel();
+    }
+  };
+}
+
+// Threaded calls still running per HostApi instance. waitForHostApiCalls blocks on it so an owner
+// never deletes an object a worker is inside of.
+struct HostApiThreadedCalls {
+  QMutex mutex;
+  QWaitCondition finished;
+  QHash<const QObject *, int> running;
+};
+
+HostApiThreadedCalls &hostApiThreadedCalls() {
+  static HostApiThreadedCalls calls;
+  return calls;
+}
+
+// Runs call on a QThreadPool worker and delivers its result on the GUI thread. Arguments are
+// unpacked before the hop, so the worker never touches the channel's JSON. context must outlive
+// the call; its owner guarantees that through waitForHostApiCalls.
+template <typename T, typename Call>
+HostApiRpcCancel hostApiRpcThreaded(QObject *context, const HostApiRpcCallback &done, Call call) {
+  const auto cancelled = std::make_shared<std::atomic_bool>(false);
+  const QPointer<QObject> guard(context);
+  {
+    HostApiThreadedCalls &calls = hostApiThreadedCalls();
+    QMutexLocker locker(&calls.mutex);
+    ++calls.running[context];
+  }
+  QThreadPool::globalInstance()->start([context, guard, done, call, cancelled]() {
+    HostApiRpcResult result;
+    try {
+      if constexpr (std::is_void_v<T>) {
+        call();
+        result = hostApiRpcValue();
+      } else {
+        result = hostApiRpcValue(hostApiToJson(call()));
+      }
+    } catch (const std::exception &error) {
+      result = hostApiRpcError(QStringLiteral("exception"), QString::fromUtf8(error.what()));
+    } catch (...) {
+      result = hostApiRpcError(QStringLiteral("exception"), QStringLiteral("The call threw."));
+    }
+    {
+      HostApiThreadedCalls &calls = hostApiThreadedCalls();
+      QMutexLocker locker(&calls.mutex);
+      if (--calls.running[context] == 0) {
+        calls.running.remove(context);
+      }
+      calls.finished.wakeAll();
+    }
+    QMetaObject::invokeMethod(
+        QCoreApplication::instance(),
+        [guard, done, result, cancelled]() {
+          if (guard && !cancelled->load()) {
+            done(result);
+          }
+        },
+        Qt::QueuedConnection);
+  });
+  return [cancelled]() { cancelled->store(true); };
+}
+
+} // namespace
+
+)CPP";
+
+QString cppCallExpression(const MethodInfo &method) {
+  QStringList args;
+  for (int i = 0; i < method.params.size(); ++i) {
+    args.append(QStringLiteral("hostApiArg<%1>(args, %2)").arg(normalizeType(method.params[i].qtType)).arg(i));
+  }
+  return "instance->" + method.name + "(" + args.join(", ") + ")";
+}
+
+// Emits the statements that call method on instance with arguments from args and report the
+// result through done, each line prefixed with indent.
+QString generateCppMethodCall(const MethodInfo &method, const QString &indent) {
+  QString text;
+  const QString call = cppCallExpression(method);
+  if (method.threaded) {
+    QStringList captures = {QStringLiteral("instance")};
+    QStringList locals;
+    for (int i = 0; i < method.params.size(); ++i) {
+      const QString local = QStringLiteral("arg%1").arg(i);
+      text += indent + "auto " + local + " = hostApiArg<" + normalizeType(method.params[i].qtType) +
+              ">(args, " + QString::number(i) + ");\n";
+      captures.append(local);
+      locals.append(local);
+    }
+    text += indent + "return hostApiRpcThreaded<" + method.qtValue + ">(instance, done, [" +
+            captures.join(", ") + "]() {\n";
+    text += indent + "  return instance->" + method.name + "(" + locals.join(", ") + ");\n";
+    text += indent + "});\n";
+    return text;
+  }
+  if (method.returnsFuture) {
+    text += indent + "return hostApiRpcFuture(" + call + ", instance, done);\n";
+    return text;
+  }
+  if (method.returnsVoid) {
+    text += indent + call + ";\n";
+    text += indent + "done(hostApiRpcValue());\n";
+  } else {
+    text += indent + "done(hostApiRpcValue(hostApiToJson(" + call + ")));\n";
+  }
+  text += indent + "return {};\n";
+  return text;
+}
+
+QString generateCppInvoker(const ClassInfo &info) {
+  QString text;
+  text += "static HostApiRpcCancel invoke" + info.cppName + "(" + info.cppName +
+          " *instance, const QString &method,\n";
+  text += "                                        const QJsonArray &args, const HostApiRpcCallback &done) {\n";
+  QStringList methodNames;
+  for (const auto &method : info.methods) {
+    if (!methodNames.contains(method.name)) {
+      methodNames.append(method.name);
+    }
+    text += "  if (method == QLatin1String(\"" + method.name + "\") && args.size() == " +
+            QString::number(method.params.size()) + ") {\n";
+    text += generateCppMethodCall(method, QStringLiteral("    "));
+    text += "  }\n";
+  }
+  if (!methodNames.isEmpty()) {
+    QStringList checks;
+    for (const auto &name : methodNames) {
+      checks.append("method == QLatin1String(\"" + name + "\")");
+    }
+    text += "  if (" + checks.join(" || ") + ") {\n";
+    text += "    done(hostApiRpcError(QStringLiteral(\"invalid_arguments\"),\n";
+    text += "                         QStringLiteral(\"Wrong number of arguments for " + info.name +
+            ".\") + method));\n";
+    text += "    return {};\n";
+    text += "  }\n";
+  }
+  text += "  done(hostApiRpcError(QStringLiteral(\"unknown_method\"),\n";
+  text += "                       QStringLiteral(\"Unknown method " + info.name + ".\") + method));\n";
+  text += "  return {};\n";
+  text += "}\n\n";
+  return text;
+}
+
+// One switch over every method of every class, so a call resolved to its dispatchIndex skips the
+// method name comparisons of invokeHostApiMethod.
+QString generateCppIndexInvoker(const QList<ClassInfo> &classes) {
+  QString text;
+  text += "int hostApiMethodIndex(const QString &objectName, const QString &method, int argCount) {\n";
+  for (const auto &info : classes) {
+    if (info.methods.isEmpty()) {
+      continue;
+    }
+    text += "  if (objectName == QLatin1String(\"" + info.name + "\")) {\n";
+    for (const auto &method : info.methods) {
+      text += "    if (method == QLatin1String(\"" + method.name + "\") && argCount == " +
+              QString::number(method.params.size()) + ") {\n";
+      text += "      return " + QString::number(method.dispatchIndex) + ";\n";
+      text += "    }\n";
+    }
+    text += "    return -1;\n";
+    text += "  }\n";
+  }
+  text += "  return -1;\n";
+  text += "}\n\n";
+
+  text += "HostApiRpcCancel invokeHostApiMethodIndex(const HostApiObjectInfo &object, int methodIndex,\n";
+  text += "                                          const QJsonArray &args,\n";
+  text += "                                          const HostApiRpcCallback &done) {\n";
+  text += "  try {\n";
+  text += "    switch (methodIndex) {\n";
+  for (const auto &info : classes) {
+    for (const auto &method : info.methods) {
+      text += "    case " + QString::number(method.dispatchIndex) + ": {\n";
+      text += "      auto *instance = qobject_cast<" + info.cppName + " *>(object.instance);\n";
+      text += "      if (!instance || args.size() != " + QString::number(method.params.size()) +
+              ") {\n";
+      text += "        break;\n";
+      text += "      }\n";
+      text += generateCppMethodCall(method, QStringLiteral("      "));
+      text += "    }\n";
+    }
+  }
+  text += "    default:\n";
+  text += "      break;\n";
+  text += "    }\n";
+  text += "  } catch (const HostApiArgumentError &error) {\n";
+  text += "    done(hostApiRpcError(QStringLiteral(\"invalid_arguments\"), error.message));\n";
+  text += "    return {};\n";
+  text += "  } catch (const std::exception &error) {\n";
+  text += "    done(hostApiRpcError(QStringLiteral(\"exception\"), QString::fromUtf8(error.what())));\n";
+  text += "    return {};\n";
+  text += "  } catch (...) {\n";
+  text += "    done(hostApiRpcError(QStringLiteral(\"exception\"), QStringLiteral(\"The call threw.\")));\n";
+  text += "    return {};\n";
+  text += "  }\n";
+  text += "  done(hostApiRpcError(QStringLiteral(\"unknown_method\"),\n";
+  text += "                       QStringLiteral(\"Unknown method index %1 with %2 arguments for %3.\")\n";
+  text += "                           .arg(methodIndex)\n";
+  text += "                           .arg(args.size())\n";
+  text += "                           .arg(object.name)));\n";
+  text += "  return {};\n";
+  text += "}\n\n";
+  return text;
+}
+
+QString generateCppSignalRelay(const ClassInfo &info) {
+  QString text;
+  text += "static void relay" + info.cppName + "Signals(" + info.cppName +
+          " *instance, const HostApiSignalRelay &relay) {\n";
+  if (info.signalInfos.isEmpty()) {
+    text += "  Q_UNUSED(instance);\n";
+    text += "  Q_UNUSED(relay);\n";
+  }
+  // moc lists a signal with default arguments once per arity; connect the full one only.
+  // Overloaded signals are not supported on shared classes.
+  QSet<QString> connected;
+  for (const auto &signal : info.signalInfos) {
+    if (connected.contains(signal.name)) {
+      continue;
+    }
+    connected.insert(signal.name);
+    QStringList params;
+    QStringList values;
+    for (const auto &param : signal.params) {
+      params.append("const " + normalizeType(param.qtType) + " &" + param.name);
+      values.append("hostApiToJson(" + param.name + ")");
+    }
+    text += "  QObject::connect(instance, &" + info.cppName + "::" + signal.name + ", instance,\n";
+    text += "                   [relay](" + params.join(", ") + ") {\n";
+    text += "                     relay(QStringLiteral(\"" + signal.name + "\"), QJsonArray{" +
+            values.join(", ") + "});\n";
+    text += "                   });\n";
+  }
+  text += "}\n\n";
+  return text;
+}
+
+QString jsString(const QString &value) {
+  const QString array =
+      QString::fromUtf8(QJsonDocument(QJsonArray{value}).toJson(QJsonDocument::Compact));
+  return array.mid(1, array.size() - 2);
+}
+
+// Emits a minified object literal with one entry per class: f(o) builds the wrapper from the
+// bootstrap's o.c(method, dispatchIndex, args, options) and o.h(signals, eventName, handler, connect), n lists the
+// signals and d marks HOSTAPI_SHARED. Each method gets a stub with fixed parameters and handler
+// lookups go through the signal table s, so nothing is derived from the schema at runtime.
+QString generateJsWrappers(const QList<ClassInfo> &classes) {
+  QStringList entries;
+  for (const auto &info : classes) {
+    QStringList members;
+    for (const auto &method : info.methods) {
+      QStringList params;
+      for (int i = 0; i < method.params.size(); ++i) {
+        params.append(QStringLiteral("p%1").arg(i));
+      }
+      const QString args = params.join(',');
+      params.append(QStringLiteral("x"));
+      members.append(jsString(method.name) + ":function(" + params.join(',') + "){return o.c(" +
+                     jsString(method.name) + "," + QString::number(method.dispatchIndex) + ",[" +
+                     args + "],x)}");
+    }
+    members.append(QStringLiteral("registerEventHandler:function(e,h){o.h(s,e,h,1)}"));
+    members.append(QStringLiteral("removeEventHandler:function(e,h){o.h(s,e,h,0)}"));
+
+    QStringList signalTable;
+    QStringList signalNames;
+    for (const auto &signal : info.signalInfos) {
+      signalTable.append(jsString(signal.name) + ":1");
+      signalNames.append(jsString(signal.name));
+    }
+
+    QString entry = jsString(info.name) + ":{f:function(o){var s={" + signalTable.join(',') +
+                    "};return{" + members.join(',') + "}},n:[" + signalNames.join(',') + "]";
+    if (info.shared) {
+      entry += ",d:1";
+    }
+    entries.append(entry + "}");
+  }
+  return "{" + entries.join(',') + "}";
+}
+
+QString cppStringLiteral(const QString &value) {
+  QString escaped = value;
+  escaped.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
+  escaped.replace(QLatin1Char('"'), QLatin1String("\\\""));
+  return "QStringLiteral(\"" + escaped + "\")";
+}
+
+// Emits value as nested QJsonObject/QJsonArray initializers, so the generated hostApiSchema()
+// builds its object without parsing JSON text.
+QString cppJsonExpression(const QJsonValue &value, const QString &indent) {
+  const QString inner = indent + "    ";
+  switch (value.type()) {
+  case QJsonValue::Bool:
+    return value.toBool() ? QStringLiteral("true") : QStringLiteral("false");
+  case QJsonValue::Double:
+    return "QJsonValue(" + QString::number(value.toDouble(), 'g', 17) + ")";
+  case QJsonValue::String:
+    return cppStringLiteral(value.toString());
+  case QJsonValue::Array: {
+    const QJsonArray array = value.toArray();
+    if (array.isEmpty()) {
+      return QStringLiteral("QJsonArray()");
+    }
+    QStringList items;
+    for (const auto &item : array) {
+      items.append(inner + cppJsonExpression(item, inner));
+    }
+    return "QJsonArray{\n" + items.join(",\n") + "}";
+  }
+  case QJsonValue::Object: {
+    const QJsonObject object = value.toObject();
+    if (object.isEmpty()) {
+      return QStringLiteral("QJsonObject()");
+    }
+    QStringList items;
+    for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+      items.append(inner + "{" + cppStringLiteral(it.key()) + ", " +
+                   cppJsonExpression(it.value(), inner) + "}");
+    }
+    return "QJsonObject{\n" + items.join(",\n") + "}";
+  }
+  default:
+    return QStringLiteral("QJsonValue(QJsonValue::Null)");
+  }
+}
+
 QString generateCppSource(const QList<ClassInfo> &classes, const QJsonObject &schema) {
   QString text;
   text += "#include \"HostApiGenerated.h\"\n";
+  text += "#include \"HostApiEvent.h\"\n";
   text += "\n";
   text += "#include <QByteArray>\n";
+  text += "#include <QCoreApplication>\n";
+  text += "#include <QFuture>\n";
+  text += "#include <QFutureWatcher>\n";
+  text += "#include <QHash>\n";
   text += "#include <QJsonDocument>\n";
   text += "#include <QJsonObject>\n";
+  text += "#include <QMetaType>\n";
+  text += "#include <QMutex>\n";
+  text += "#include <QPointer>\n";
+  text += "#include <QThreadPool>\n";
+  text += "#include <QVariant>\n";
+  text += "#include <QWaitCondition>\n";
   text += "#include <QWebChannel>\n";
   text += "\n";
+  text += "#include <atomic>\n";
+  text += "#include <cmath>\n";
+  text += "#include <exception>\n";
+  text += "#include <limits>\n";
+  text += "#include <memory>\n";
+  text += "#include <type_traits>\n";
+  text += "\n";
 
   for (const auto &info : classes) {
     text += "#include \"" + info.cppName + ".h\"\n";
@@ -376,36 +965,185 @@ QString generateCppSource(const QList<ClassInfo> &classes, const QJsonObject &sc
   const QByteArray schemaJson = QJsonDocument(schema).toJson(QJsonDocument::Compact);
   text += "static const char kHostApiSchemaJson[] = R\"JSON(";
   text += QString::fromUtf8(schemaJson);
-  text += ")JSON\";\n\n";
+  text += ")JSON\";\n";
+  text += "static const char kHostApiSchemaHash[] = \"" +
+          QString::fromLatin1(
+              QCryptographicHash::hash(schemaJson, QCryptographicHash::Sha256).toHex().left(16)) +
+          "\";\n\n";
+
+  text += "static const char kHostApiWrapperScript[] = R\"JS(";
+  text += generateJsWrappers(classes);
+  text += ")JS\";\n\n";
+
+  const QStringList eventTypes = hostApiEventTypes();
+  QStringList eventNames;
+  for (const auto &eventType : eventTypes) {
+    eventNames.append(cppStringLiteral(eventType));
+  }
+  text += "QString hostApiEventName(HostApiEvent event) {\n";
+  if (eventNames.isEmpty()) {
+    text += "  Q_UNUSED(event);\n";
+    text += "  return QString();\n";
+  } else {
+    text += "  static const QString names[] = {" + eventNames.join(", ") + "};\n";
+    text += "  const int id = static_cast<int>(event);\n";
+    text += "  return id >= 0 && id < kHostApiEventCount ? names[id] : QString();\n";
+  }
+  text += "}\n\n";
 
-  text += "QJsonObject hostApiSchema() {\n";
-  text += "  static QJsonObject cached;\n";
-  text += "  static bool initialized = false;\n";
-  text += "  if (!initialized) {\n";
-  text += "    const QJsonDocument doc = QJsonDocument::fromJson(QByteArray(kHostApiSchemaJson));\n";
-  text += "    if (doc.isObject()) {\n";
-  text += "      cached = doc.object();\n";
+  text += "int hostApiEventId(const QString &eventType) {\n";
+  text += "  static const QHash<QString, int> ids = []() {\n";
+  text += "    QHash<QString, int> table;\n";
+  text += "    for (int id = 0; id < kHostApiEventCount; ++id) {\n";
+  text += "      table.insert(hostApiEventName(static_cast<HostApiEvent>(id)), id);\n";
   text += "    }\n";
-  text += "    initialized = true;\n";
-  text += "  }\n";
-  text += "  return cached;\n";
+  text += "    return table;\n";
+  text += "  }();\n";
+  text += "  return ids.value(eventType, -1);\n";
+  text += "}\n\n";
+
+  text += "QString hostApiWrapperScript() {\n";
+  text += "  static const QString script = QString::fromUtf8(kHostApiWrapperScript);\n";
+  text += "  return script;\n";
+  text += "}\n\n";
+
+  text += "QJsonObject hostApiSchema() {\n";
+  text += "  static const QJsonObject schema = " + cppJsonExpression(schema, QStringLiteral("  ")) +
+          ";\n";
+  text += "  return schema;\n";
+  text += "}\n\n";
+
+  text += "QByteArray hostApiSchemaJson() {\n";
+  text += "  return QByteArray::fromRawData(kHostApiSchemaJson, sizeof(kHostApiSchemaJson) - 1);\n";
   text += "}\n\n";
 
+  text += "QString hostApiSchemaHash() {\n";
+  text += "  return QString::fromLatin1(kHostApiSchemaHash);\n";
+  text += "}\n\n";
+
+  for (const auto &info : classes) {
+    if (!info.shared) {
+      continue;
+    }
+    text += "static " + info.cppName + " *shared" + info.cppName + "() {\n";
+    text += "  static QPointer<" + info.cppName + "> instance;\n";
+    text += "  if (!instance) {\n";
+    text += "    instance = new " + info.cppName + "(QCoreApplication::instance());\n";
+    text += "  }\n";
+    text += "  return instance;\n";
+    text += "}\n\n";
+  }
+
+  // Only eager per-host classes are constructed here with parent.
+  bool usesParent = false;
+  for (const auto &info : classes) {
+    usesParent = usesParent || (info.eager && !info.shared);
+  }
   text += "QList<HostApiObjectInfo> registerHostApiObjects(QWebChannel *channel, QObject *parent) {\n";
+  if (!usesParent) {
+    text += "  Q_UNUSED(parent);\n";
+  }
   text += "  QList<HostApiObjectInfo> objects;\n";
   text += "  if (!channel) {\n";
   text += "    return objects;\n";
   text += "  }\n";
 
   for (const auto &info : classes) {
+    if (info.shared) {
+      // Never registered on the channel, which would convert each signal's arguments once per host.
+      if (info.eager) {
+        text += "  objects.append({QStringLiteral(\"" + info.name + "\"), shared" + info.cppName +
+                "(), {}, true});\n";
+      } else {
+        text += "  objects.append({QStringLiteral(\"" + info.name + "\"), nullptr,\n";
+        text += "                  [](QObject *) -> QObject * { return shared" + info.cppName +
+                "(); }, true});\n";
+      }
+      continue;
+    }
+    if (!info.eager) {
+      // Lazy objects are handed to the page through HostBridge.hostApiObject once constructed.
+      text += "  objects.append({QStringLiteral(\"" + info.name + "\"), nullptr,\n";
+      text += "                  [](QObject *owner) -> QObject * { return new " + info.cppName +
+              "(owner); }, false});\n";
+      continue;
+    }
     text += "  {\n";
     text += "    auto *instance = new " + info.cppName + "(parent);\n";
     text += "    const QString name = QStringLiteral(\"" + info.name + "\");\n";
     text += "    channel->registerObject(QStringLiteral(\"HostApi_\") + name, instance);\n";
-    text += "    objects.append({name, instance});\n";
+    text += "    objects.append({name, instance, {}, false});\n";
     text += "  }\n";
   }
   text += "  return objects;\n";
+  text += "}\n\n";
+
+  text += QString::fromUtf8(kCppRpcHelpers);
+  text += "void waitForHostApiCalls(const QList<HostApiObjectInfo> &objects) {\n";
+  text += "  HostApiThreadedCalls &calls = hostApiThreadedCalls();\n";
+  text += "  QMutexLocker locker(&calls.mutex);\n";
+  text += "  for (const auto &object : objects) {\n";
+  text += "    while (object.instance && calls.running.contains(object.instance)) {\n";
+  text += "      calls.finished.wait(&calls.mutex);\n";
+  text += "    }\n";
+  text += "  }\n";
+  text += "}\n\n";
+  for (const auto &info : classes) {
+    text += generateCppInvoker(info);
+  }
+  for (const auto &info : classes) {
+    if (info.shared) {
+      text += generateCppSignalRelay(info);
+    }
+  }
+
+  text += generateCppIndexInvoker(classes);
+
+  text += "void relayHostApiSignals(const QString &objectName, QObject *instance,\n";
+  text += "                         const HostApiSignalRelay &relay) {\n";
+  bool anyShared = false;
+  for (const auto &info : classes) {
+    if (!info.shared) {
+      continue;
+    }
+    anyShared = true;
+    text += "  if (objectName == QLatin1String(\"" + info.name + "\")) {\n";
+    text += "    if (auto *typed = qobject_cast<" + info.cppName + " *>(instance)) {\n";
+    text += "      relay" + info.cppName + "Signals(typed, relay);\n";
+    text += "    }\n";
+    text += "    return;\n";
+    text += "  }\n";
+  }
+  if (!anyShared) {
+    text += "  Q_UNUSED(objectName);\n";
+    text += "  Q_UNUSED(instance);\n";
+    text += "  Q_UNUSED(relay);\n";
+  }
+  text += "}\n\n";
+
+  text += "HostApiRpcCancel invokeHostApiMethod(const HostApiObjectInfo &object, const QString &method,\n";
+  text += "                                     const QJsonArray &args, const HostApiRpcCallback &done) {\n";
+  text += "  try {\n";
+  for (const auto &info : classes) {
+    text += "    if (object.name == QLatin1String(\"" + info.name + "\")) {\n";
+    text += "      if (auto *instance = qobject_cast<" + info.cppName + " *>(object.instance)) {\n";
+    text += "        return invoke" + info.cppName + "(instance, method, args, done);\n";
+    text += "      }\n";
+    text += "    }\n";
+  }
+  text += "  } catch (const HostApiArgumentError &error) {\n";
+  text += "    done(hostApiRpcError(QStringLiteral(\"invalid_arguments\"), error.message));\n";
+  text += "    return {};\n";
+  text += "  } catch (const std::exception &error) {\n";
+  text += "    done(hostApiRpcError(QStringLiteral(\"exception\"), QString::fromUtf8(error.what())));\n";
+  text += "    return {};\n";
+  text += "  } catch (...) {\n";
+  text += "    done(hostApiRpcError(QStringLiteral(\"exception\"), QStringLiteral(\"The call threw.\")));\n";
+  text += "    return {};\n";
+  text += "  }\n";
+  text += "  done(hostApiRpcError(QStringLiteral(\"unknown_object\"),\n";
+  text += "                       QStringLiteral(\"Unknown HostApi object \") + object.name));\n";
+  text += "  return {};\n";
   text += "}\n";
   return text;
 }
@@ -423,6 +1161,8 @@ QString generateDts(const QList<ClassInfo> &classes) {
   text += "  returnType: string;\n";
   text += "  tsReturn: string;\n";
   text += "  returnsVoid: boolean;\n";
+  text += "  returnsFuture: boolean;\n";
+  text += "  threaded: boolean;\n";
   text += "  params: HostApiSchemaParam[];\n";
   text += "}\n\n";
   text += "export interface HostApiSchemaSignal {\n";
@@ -432,9 +1172,20 @@ QString generateDts(const QList<ClassInfo> &classes) {
   text += "export interface HostApiSchemaObject {\n";
   text += "  name: string;\n";
   text += "  cppName: string;\n";
+  text += "  eager: boolean;\n";
+  text += "  shared: boolean;\n";
   text += "  methods: HostApiSchemaMethod[];\n";
   text += "  signals: HostApiSchemaSignal[];\n";
   text += "}\n\n";
+  text += "export interface HostApiCallOptions {\n";
+  text += "  timeoutMs?: number;\n";
+  text += "  signal?: AbortSignal;\n";
+  text += "}\n\n";
+  text += "export interface HostApiError extends Error {\n";
+  text += "  code: \"timeout\" | \"aborted\" | \"cancelled\" | \"failed\" | \"exception\" | \"no_result\" |\n";
+  text += "    \"invalid_arguments\" | \"unknown_method\" | \"unknown_object\" | string;\n";
+  text += "  callId: number;\n";
+  text += "}\n\n";
   text += "export interface HostApiSchema {\n";
   text += "  version: string;\n";
   text += "  eventTypes: string[];\n";
@@ -449,6 +1200,7 @@ QString generateDts(const QList<ClassInfo> &classes) {
       for (const auto &param : method.params) {
         params.append(param.name + ": " + param.tsType);
       }
+      params.append("options?: HostApiCallOptions");
       const QString returnType = method.returnsVoid ? "Promise<void>" : "Promise<" + method.tsReturn + ">";
       text += "  " + method.name + "(" + params.join(", ") + "): " + returnType + ";\n";
     }
@@ -471,15 +1223,33 @@ QString generateDts(const QList<ClassInfo> &classes) {
     text += "}\n\n";
   }
 
+  text += "// Ids of HostApi.validEventTypes; addEventListener accepts them in place of the names.\n";
+  text += "export const enum HostApiEvent {\n";
+  const QStringList eventTypes = hostApiEventTypes();
+  for (int i = 0; i < eventTypes.size(); ++i) {
+    text += "  " + toPascalCase(eventTypes[i]) + " = " + QString::number(i) + ",\n";
+  }
+  text += "}\n\n";
+
   text += "export interface HostApiRoot {\n";
   text += "  version: string;\n";
-  text += "  schema: HostApiSchema;\n";
+  text += "  // Null until loadSchema() resolves, unless a copy cached under schemaHash was found.\n";
+  text += "  schema: HostApiSchema | null;\n";
+  text += "  schemaHash: string;\n";
+  text += "  loadSchema(): Promise<HostApiSchema>;\n";
   text += "  validEventTypes: string[];\n";
   text += "  sendData(payload: any): void;\n";
   text += "  setOutput(text: string): void;\n";
   text += "  getInput(): Promise<string>;\n";
-  text += "  addEventListener(eventName: string, handler: (payload: any) => void): void;\n";
-  text += "  removeEventListener(eventName: string, handler: (payload: any) => void): void;\n";
+  text += "  fetchBlob(id: string): Promise<ArrayBuffer>;\n";
+  text += "  upload(name: string, body: BodyInit, options?: { signal?: AbortSignal }): "
+          "Promise<{ id: string; size: number }>;\n";
+  text += "  openStream(id: string, options?: { highWaterMark?: number }): "
+          "ReadableStream<Uint8Array>;\n";
+  text += "  // Return true from handler to apply changed non-stylesheet files without a page reload.\n";
+  text += "  setHotReloadHandler(handler: ((paths: string[]) => boolean) | null): void;\n";
+  text += "  addEventListener(eventName: HostApiEvent | string, handler: (payload: any) => void): void;\n";
+  text += "  removeEventListener(eventName: HostApiEvent | string, handler: (payload: any) => void): void;\n";
   for (const auto &info : classes) {
     const QString ifaceName = toPascalCase(info.name);
     text += "  " + info.name + ": " + ifaceName + "Api;\n";
@@ -515,6 +1285,8 @@ QString generateAngularService(const ClassInfo &info) {
       params.append(param.name + ": " + param.tsType);
       paramNames.append(param.name);
     }
+    params.append("options?: { timeoutMs?: number; signal?: AbortSignal }");
+    paramNames.append("options");
     const QString returnType = method.returnsVoid ? "Promise<void>" : "Promise<" + method.tsReturn + ">";
     text += "  " + method.name + "(" + params.join(", ") + "): " + returnType + " {\n";
     text += "    return this.api." + method.name + "(" + paramNames.join(", ") + ");\n";
@@ -637,6 +1409,13 @@ int main(int argc, char **argv) {
     classes.append(buildClassInfo(desc.meta, exportName, &warnings));
   }
 
+  int dispatchIndex = 0;
+  for (auto &info : classes) {
+    for (auto &method : info.methods) {
+      method.dispatchIndex = dispatchIndex++;
+    }
+  }
+
   for (const auto &warning : warnings) {
     QTextStream(stderr) << "HostApiGenerator: " << warning << "\n";
   }
@@ -651,6 +1430,7 @@ int main(int argc, char **argv) {
   schema.insert(QStringLiteral("objects"), objectsArray);
 
   const QString headerPath = out.filePath("HostApiGenerated.h");
+  const QString eventHeaderPath = out.filePath("HostApiEvent.h");
   const QString sourcePath = out.filePath("HostApiGenerated.cpp");
   const QString schemaPath = out.filePath("hostapi_schema.json");
   const QString dtsPath = out.filePath("hostapi.d.ts");
@@ -662,6 +1442,11 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  if (!writeFile(eventHeaderPath, generateEventHeader(hostApiEventTypes()))) {
+    QTextStream(stderr) << "Failed to write " << eventHeaderPath << "\n";
+    return 1;
+  }
+
   if (!writeFile(sourcePath, generateCppSource(classes, schema))) {
     QTextStream(stderr) << "Failed to write " << sourcePath << "\n";
     return 1;
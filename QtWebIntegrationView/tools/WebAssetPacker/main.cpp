@@ -0,0 +1,131 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QList>
+#include <QSaveFile>
+#include <QString>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstring>
+
+#include "WebHost/src/WebAssetPackFormat.h"
+
+namespace {
+
+struct PackInput {
+  QByteArray path;
+  QString filePath;
+  QByteArray data;
+};
+
+quint64 alignUp(quint64 value, quint64 alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+bool writePadding(QSaveFile &file, quint64 targetOffset) {
+  const qint64 padding = qint64(targetOffset) - file.pos();
+  return padding <= 0 || file.write(QByteArray(padding, '\0')) == padding;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  QCoreApplication app(argc, argv);
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Packs a web root into a memory-mappable WebHost asset pack");
+  parser.addHelpOption();
+
+  QCommandLineOption inputOpt(QStringList() << "i" << "input", "Web root directory to pack.",
+                              "path");
+  QCommandLineOption outputOpt(QStringList() << "o" << "output", "Pack file to write.", "path");
+  parser.addOption(inputOpt);
+  parser.addOption(outputOpt);
+  parser.process(app);
+
+  const QString inputDir = parser.value(inputOpt);
+  const QString outputPath = parser.value(outputOpt);
+  if (inputDir.isEmpty() || outputPath.isEmpty()) {
+    QTextStream(stderr) << "--input and --output are required.\n";
+    return 1;
+  }
+
+  const QDir root(inputDir);
+  if (!root.exists()) {
+    QTextStream(stderr) << "Input dir does not exist: " << inputDir << "\n";
+    return 1;
+  }
+
+  QList<PackInput> inputs;
+  QDirIterator it(root.absolutePath(), QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    const QString filePath = it.next();
+    if (filePath.endsWith(QLatin1String(".DS_Store"))) {
+      continue;
+    }
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+      QTextStream(stderr) << "Failed to read " << filePath << ": " << file.errorString() << "\n";
+      return 1;
+    }
+    inputs.append({root.relativeFilePath(filePath).toUtf8(), filePath, file.readAll()});
+  }
+  std::sort(inputs.begin(), inputs.end(),
+            [](const PackInput &a, const PackInput &b) { return a.path < b.path; });
+
+  using namespace WebAssetPackFormat;
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.entryCount = quint32(inputs.size());
+  header.indexOffset = sizeof(Header);
+  header.stringsOffset = sizeof(Header) + quint64(inputs.size()) * sizeof(Entry);
+
+  QByteArray strings;
+  QList<Entry> entries(inputs.size());
+  for (qsizetype i = 0; i < inputs.size(); ++i) {
+    Entry &entry = entries[i];
+    std::memset(&entry, 0, sizeof(Entry));
+    entry.pathOffset = quint32(strings.size());
+    entry.pathLength = quint32(inputs.at(i).path.size());
+    strings.append(inputs.at(i).path);
+  }
+
+  quint64 offset = alignUp(header.stringsOffset + quint64(strings.size()), kAlignment);
+  for (qsizetype i = 0; i < inputs.size(); ++i) {
+    Entry &entry = entries[i];
+    const QByteArray &data = inputs.at(i).data;
+    const QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+    std::memcpy(entry.sha256, hash.constData(), sizeof(entry.sha256));
+    entry.dataOffset = offset;
+    entry.dataSize = quint64(data.size());
+    offset = alignUp(offset + quint64(data.size()), kAlignment);
+  }
+
+  QSaveFile out(outputPath);
+  if (!out.open(QIODevice::WriteOnly)) {
+    QTextStream(stderr) << "Failed to write " << outputPath << ": " << out.errorString() << "\n";
+    return 1;
+  }
+  bool ok = out.write(reinterpret_cast<const char *>(&header), sizeof(Header)) == sizeof(Header);
+  for (const Entry &entry : std::as_const(entries)) {
+    ok = ok && out.write(reinterpret_cast<const char *>(&entry), sizeof(Entry)) == sizeof(Entry);
+  }
+  ok = ok && out.write(strings) == strings.size();
+  for (qsizetype i = 0; ok && i < inputs.size(); ++i) {
+    ok = writePadding(out, entries.at(i).dataOffset) &&
+         out.write(inputs.at(i).data) == inputs.at(i).data.size();
+  }
+  const qint64 packSize = out.pos();
+  if (!ok || !out.commit()) {
+    QTextStream(stderr) << "Failed to write " << outputPath << ": " << out.errorString() << "\n";
+    return 1;
+  }
+
+  QTextStream(stdout) << "Packed " << inputs.size() << " files into " << outputPath << " ("
+                      << packSize << " bytes)\n";
+  return 0;
+}
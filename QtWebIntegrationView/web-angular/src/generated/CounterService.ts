@@ -0,0 +1,27 @@
+import { Injectable } from "@angular/core";
+
+@Injectable({ providedIn: "root" })
+export class CounterService {
+  private get api() {
+    if (!window || !window.HostApi || !window.HostApi.counter) {
+      throw new Error("HostApi is not ready.");
+    }
+    return window.HostApi.counter;
+  }
+
+  increment(options?: { timeoutMs?: number; signal?: AbortSignal }): Promise<number> {
+    return this.api.increment(options);
+  }
+
+  value(options?: { timeoutMs?: number; signal?: AbortSignal }): Promise<number> {
+    return this.api.value(options);
+  }
+
+  registerEventHandler(eventName: "valueChanged", handler: (value: number) => void): void {
+    this.api.registerEventHandler(eventName, handler);
+  }
+
+  removeEventHandler(eventName: "valueChanged", handler: (value: number) => void): void {
+    this.api.removeEventHandler(eventName, handler);
+  }
+}
@@ -9,16 +9,24 @@ export class ExampleService {
     return window.HostApi.example;
   }
 
-  setStatus(status: string): Promise<void> {
-    return this.api.setStatus(status);
+  setStatus(status: string, options?: { timeoutMs?: number; signal?: AbortSignal }): Promise<void> {
+    return this.api.setStatus(status, options);
   }
 
-  echo(text: string): Promise<string> {
-    return this.api.echo(text);
+  echo(text: string, options?: { timeoutMs?: number; signal?: AbortSignal }): Promise<string> {
+    return this.api.echo(text, options);
   }
 
-  add(a: number, b: number): Promise<number> {
-    return this.api.add(a, b);
+  add(a: number, b: number, options?: { timeoutMs?: number; signal?: AbortSignal }): Promise<number> {
+    return this.api.add(a, b, options);
+  }
+
+  delayedEcho(text: string, delayMs: number, options?: { timeoutMs?: number; signal?: AbortSignal }): Promise<string> {
+    return this.api.delayedEcho(text, delayMs, options);
+  }
+
+  slowAdd(a: number, b: number, delayMs: number, options?: { timeoutMs?: number; signal?: AbortSignal }): Promise<number> {
+    return this.api.slowAdd(a, b, delayMs, options);
   }
 
   registerEventHandler(eventName: "statusChanged", handler: (status: string) => void): void {
@@ -1,8 +1,101 @@
+// Generated HostApi types. Do not edit.
+
+export interface HostApiSchemaParam {
+  name: string;
+  type: string;
+  tsType: string;
+}
+
+export interface HostApiSchemaMethod {
+  name: string;
+  returnType: string;
+  tsReturn: string;
+  returnsVoid: boolean;
+  returnsFuture: boolean;
+  threaded: boolean;
+  params: HostApiSchemaParam[];
+}
+
+export interface HostApiSchemaSignal {
+  name: string;
+  params: HostApiSchemaParam[];
+}
+
+export interface HostApiSchemaObject {
+  name: string;
+  cppName: string;
+  eager: boolean;
+  shared: boolean;
+  methods: HostApiSchemaMethod[];
+  signals: HostApiSchemaSignal[];
+}
+
+export interface HostApiCallOptions {
+  timeoutMs?: number;
+  signal?: AbortSignal;
+}
+
+export interface HostApiError extends Error {
+  code: "timeout" | "aborted" | "cancelled" | "failed" | "exception" | "no_result" |
+    "invalid_arguments" | "unknown_method" | "unknown_object" | string;
+  callId: number;
+}
+
+export interface HostApiSchema {
+  version: string;
+  eventTypes: string[];
+  objects: HostApiSchemaObject[];
+}
+
+export interface ExampleApi {
+  setStatus(status: string, options?: HostApiCallOptions): Promise<void>;
+  echo(text: string, options?: HostApiCallOptions): Promise<string>;
+  add(a: number, b: number, options?: HostApiCallOptions): Promise<number>;
+  delayedEcho(text: string, delayMs: number, options?: HostApiCallOptions): Promise<string>;
+  slowAdd(a: number, b: number, delayMs: number, options?: HostApiCallOptions): Promise<number>;
+  registerEventHandler(eventName: "statusChanged", handler: (status: string) => void): void;
+  removeEventHandler(eventName: "statusChanged", handler: (status: string) => void): void;
+  __raw?: any;
+}
+
+export interface CounterApi {
+  increment(options?: HostApiCallOptions): Promise<number>;
+  value(options?: HostApiCallOptions): Promise<number>;
+  registerEventHandler(eventName: "valueChanged", handler: (value: number) => void): void;
+  removeEventHandler(eventName: "valueChanged", handler: (value: number) => void): void;
+  __raw?: any;
+}
+
+// Ids of HostApi.validEventTypes; addEventListener accepts them in place of the names.
+export const enum HostApiEvent {
+  ActionOne = 0,
+  ActionTwo = 1,
+}
+
+export interface HostApiRoot {
+  version: string;
+  // Null until loadSchema() resolves, unless a copy cached under schemaHash was found.
+  schema: HostApiSchema | null;
+  schemaHash: string;
+  loadSchema(): Promise<HostApiSchema>;
+  validEventTypes: string[];
+  sendData(payload: any): void;
+  setOutput(text: string): void;
+  getInput(): Promise<string>;
+  fetchBlob(id: string): Promise<ArrayBuffer>;
+  upload(name: string, body: BodyInit, options?: { signal?: AbortSignal }): Promise<{ id: string; size: number }>;
+  openStream(id: string, options?: { highWaterMark?: number }): ReadableStream<Uint8Array>;
+  // Return true from handler to apply changed non-stylesheet files without a page reload.
+  setHotReloadHandler(handler: ((paths: string[]) => boolean) | null): void;
+  addEventListener(eventName: HostApiEvent | string, handler: (payload: any) => void): void;
+  removeEventListener(eventName: HostApiEvent | string, handler: (payload: any) => void): void;
+  example: ExampleApi;
+  counter: CounterApi;
+}
+
 declare global {
   interface Window {
-    HostApi?: any;
+    HostApi: HostApiRoot;
     HostApiExpectedVersion?: string;
   }
 }
-
-export {};